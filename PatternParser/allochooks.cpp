@@ -0,0 +1,101 @@
+/*
+ * Counting replacement of the global operator new/delete, feeding memstats.h.
+ *
+ * Opt-in: add this file to an executable (the benchmark does) to get
+ * allocation counts, bytes and peaks in Pattern::stats. Every block carries
+ * a small header with its size and subsystem tag.
+ */
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+#include "memstats.h"
+
+namespace {
+
+struct Header {
+	size_t size;
+	size_t offset;	// from the start of the malloc'ed block to the user pointer
+	SUBSYSTEM subsystem;
+};
+
+// A multiple of alignof(max_align_t) so plain new stays suitably aligned.
+const size_t HEADER_SPACE = (sizeof(Header) + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+
+void *allocate(size_t size, size_t align) {
+	size_t space = align > HEADER_SPACE ? align : HEADER_SPACE;
+	char *base;
+#ifdef _MSC_VER
+	// MSVC has no aligned_alloc, and _aligned_malloc blocks need _aligned_free
+	base = (char *)_aligned_malloc(space + size, align > alignof(std::max_align_t) ? align : alignof(std::max_align_t));
+#else
+	if (align > alignof(std::max_align_t)) {
+		size_t total = (space + size + align - 1) / align * align;
+		base = (char *)aligned_alloc(align, total);
+	}
+	else {
+		base = (char *)malloc(space + size);
+	}
+#endif
+	if (!base) return NULL;
+
+	char *user = base + space;
+	Header *h = (Header *)user - 1;
+	h->size = size;
+	h->offset = space;
+	h->subsystem = currentSubsystem();
+	memRecordAlloc(size, h->subsystem);
+	return user;
+}
+
+void release(void *p) {
+	if (!p) return;
+	Header *h = (Header *)p - 1;
+	memRecordFree(h->size, h->subsystem);
+#ifdef _MSC_VER
+	_aligned_free((char *)p - h->offset);
+#else
+	free((char *)p - h->offset);
+#endif
+}
+
+void *allocateOrThrow(size_t size, size_t align) {
+	void *p = allocate(size ? size : 1, align);
+	if (!p) throw std::bad_alloc();
+	return p;
+}
+
+}
+
+void *operator new(size_t size) {
+	return allocateOrThrow(size, alignof(std::max_align_t));
+}
+void *operator new[](size_t size) {
+	return allocateOrThrow(size, alignof(std::max_align_t));
+}
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+	return allocate(size ? size : 1, alignof(std::max_align_t));
+}
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+	return allocate(size ? size : 1, alignof(std::max_align_t));
+}
+void *operator new(size_t size, std::align_val_t align) {
+	return allocateOrThrow(size, (size_t)align);
+}
+void *operator new[](size_t size, std::align_val_t align) {
+	return allocateOrThrow(size, (size_t)align);
+}
+
+void operator delete(void *p) noexcept { release(p); }
+void operator delete[](void *p) noexcept { release(p); }
+void operator delete(void *p, size_t) noexcept { release(p); }
+void operator delete[](void *p, size_t) noexcept { release(p); }
+void operator delete(void *p, const std::nothrow_t &) noexcept { release(p); }
+void operator delete[](void *p, const std::nothrow_t &) noexcept { release(p); }
+void operator delete(void *p, std::align_val_t) noexcept { release(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { release(p); }
+void operator delete(void *p, size_t, std::align_val_t) noexcept { release(p); }
+void operator delete[](void *p, size_t, std::align_val_t) noexcept { release(p); }
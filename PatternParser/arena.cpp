@@ -0,0 +1,117 @@
+#include "arena.h"
+#include <cassert>
+#include <cstdint>
+#include <new>
+
+static size_t roundUp(size_t bytes) {
+	return (bytes + SOA_ALIGN - 1) & ~(SOA_ALIGN - 1);
+}
+
+static char *newBlock(size_t size) {
+	return (char *)::operator new(size, std::align_val_t(SOA_ALIGN));
+}
+
+static void deleteBlock(char *data) {
+	::operator delete(data, std::align_val_t(SOA_ALIGN));
+}
+
+/*
+ * Outside a scope memory comes from the heap with a header in front, one
+ * alignment unit long, so deallocate() can tell it from pointers it never
+ * handed out.
+ */
+struct HeapHeader {
+	uintptr_t tag;	// HEAP_TAG ^ address of the header
+	size_t bytes;
+};
+static_assert(sizeof(HeapHeader) <= SOA_ALIGN, "header must fit in front of aligned data");
+
+const uintptr_t HEAP_TAG = (uintptr_t)0x5c7a7c4a11c0ffeeull;
+
+static void *heapAllocate(size_t bytes) {
+	char *block = newBlock(SOA_ALIGN + bytes);
+	HeapHeader *h = (HeapHeader *)block;
+	h->tag = HEAP_TAG ^ (uintptr_t)h;
+	h->bytes = bytes;
+	return block + SOA_ALIGN;
+}
+
+static void heapDeallocate(void *p, size_t bytes) {
+	char *block = (char *)p - SOA_ALIGN;
+	HeapHeader *h = (HeapHeader *)block;
+	bool ours = h->tag == (HEAP_TAG ^ (uintptr_t)h) && h->bytes == bytes;
+	assert(ours && "pointer was not allocated by ScratchArena");
+	if (!ours)
+		return;	// never hand a foreign pointer to the heap
+	h->tag = 0;	// a second free fails the check above
+	deleteBlock(block);
+}
+
+ScratchArena::ScratchArena() :used(0), depth(0) {}
+
+ScratchArena::~ScratchArena() {
+	for (const Block &b : blocks)
+		deleteBlock(b.data);
+}
+
+ScratchArena &ScratchArena::local() {
+	static thread_local ScratchArena arena;
+	return arena;
+}
+
+bool ScratchArena::owns(const void *p) const {
+	for (const Block &b : blocks) {
+		if (p >= b.data && p < b.data + b.size)
+			return true;
+	}
+	return false;
+}
+
+void *ScratchArena::allocate(size_t bytes) {
+	if (!active())
+		return heapAllocate(roundUp(bytes));
+	bytes = roundUp(bytes);
+	if (blocks.empty() || used + bytes > blocks.back().size) {
+		size_t size = blocks.empty() ? FIRST_BLOCK : 2 * blocks.back().size;
+		while (size < bytes)
+			size *= 2;
+		Block b = { newBlock(size), size };
+		blocks.push_back(b);
+		used = 0;
+	}
+	void *p = blocks.back().data + used;
+	used += bytes;
+	return p;
+}
+
+void ScratchArena::deallocate(void *p, size_t bytes) {
+	if (!owns(p)) {
+		heapDeallocate(p, roundUp(bytes));
+		return;
+	}
+	assert(active() && "arena memory freed after its ScratchScope closed");
+	// the latest allocation is handed back, anything older waits for release()
+	bytes = roundUp(bytes);
+	if ((char *)p + bytes == blocks.back().data + used)
+		used -= bytes;
+}
+
+size_t ScratchArena::capacity() const {
+	size_t total = 0;
+	for (const Block &b : blocks)
+		total += b.size;
+	return total;
+}
+
+void ScratchArena::release() {
+	used = 0;
+	if (blocks.size() <= 1)
+		return;
+	// one block that holds what this parse needed
+	size_t total = capacity();
+	for (const Block &b : blocks)
+		deleteBlock(b.data);
+	blocks.clear();
+	Block b = { newBlock(total), total };
+	blocks.push_back(b);
+}
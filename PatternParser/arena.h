@@ -0,0 +1,92 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "soa.h"
+
+/*
+ * Per-thread bump arena for the scratch memory of a parse.
+ *
+ * Pattern::parse() opens a ScratchScope; while one is open on a thread,
+ * ScratchAllocator takes memory from that thread's arena by bumping a
+ * pointer, frees are no-ops (except for the latest allocation, which is
+ * given back so a growing vector can reuse its space), and closing the
+ * outermost scope rewinds the arena in O(1). A parse that outgrew the arena
+ * leaves it one block as large as everything it used, so the parses after
+ * it on the same thread run without calling the heap. Outside a scope
+ * ScratchAllocator falls back to the heap, tagging each block so that
+ * freeing a pointer the arena did not hand out asserts instead.
+ *
+ * Only the thread that opened the scope may allocate scratch memory, so
+ * code run on the thread pool keeps to plain containers.
+ */
+
+class ScratchArena {
+private:
+	struct Block {
+		char *data;
+		size_t size;
+	};
+	std::vector<Block> blocks;	// the last one is being filled
+	size_t used;	// bytes taken from the last block
+	int depth;	// open scopes
+
+	ScratchArena();
+	~ScratchArena();
+	ScratchArena(const ScratchArena &) = delete;
+	ScratchArena &operator=(const ScratchArena &) = delete;
+
+	bool owns(const void *p) const;
+	void release();
+
+public:
+	static const size_t FIRST_BLOCK = 64 * 1024;
+
+	static ScratchArena &local();	// this thread's arena
+
+	void *allocate(size_t bytes);
+	void deallocate(void *p, size_t bytes);
+
+	bool active() const { return depth > 0; }
+	size_t capacity() const;	// bytes held for reuse
+
+	void enter() { depth++; }
+	void leave() { if (--depth == 0) release(); }
+};
+
+// Makes scratch allocations on this thread come from its arena until destroyed.
+class ScratchScope {
+private:
+	ScratchArena &arena;
+
+public:
+	ScratchScope() :arena(ScratchArena::local()) { arena.enter(); }
+	~ScratchScope() { arena.leave(); }
+};
+
+template <class T>
+struct ScratchAllocator {
+	typedef T value_type;
+
+	ScratchAllocator() {}
+	template <class U>
+	ScratchAllocator(const ScratchAllocator<U> &) {}
+
+	T *allocate(size_t n) {
+		return (T *)ScratchArena::local().allocate(n * sizeof(T));
+	}
+	void deallocate(T *p, size_t n) {
+		ScratchArena::local().deallocate(p, n * sizeof(T));
+	}
+
+	template <class U>
+	bool operator==(const ScratchAllocator<U> &) const { return true; }
+	template <class U>
+	bool operator!=(const ScratchAllocator<U> &) const { return false; }
+};
+
+template <class T>
+using ScratchVector = std::vector<T, ScratchAllocator<T>>;
+
+// Structure-of-arrays temporaries, copied into the persistent arrays with assign().
+typedef BasicVertexArray<ScratchVector> ScratchVertexArray;
+typedef BasicEdgeArray<ScratchVector> ScratchEdgeArray;
@@ -0,0 +1,48 @@
+#include "docpool.h"
+#include <cstdio>
+
+using namespace tinyxml2;
+
+// Starting ratios, measured over the assets corpus.
+static const double DEFAULT_PER_BYTE[] = { 0.0072, 0.051, 0.0 };
+const double LEARN_RATE = 0.25;	// weight of the latest file
+const double HEADROOM = 1.25;	// reserved over the prediction
+
+DocumentPool::DocumentPool() {
+	for (int k = 0; k < POOL_COUNT; k++)
+		perByte[k] = DEFAULT_PER_BYTE[k];
+}
+
+DocumentPool &DocumentPool::local() {
+	static thread_local DocumentPool pool;
+	return pool;
+}
+
+void DocumentPool::learn(long bytes) {
+	if (bytes <= 0)
+		return;
+	int seen[POOL_COUNT] = { document.PooledElements(), document.PooledAttributes(), document.PooledTexts() };
+	for (int k = 0; k < POOL_COUNT; k++)
+		perByte[k] += LEARN_RATE * ((double)seen[k] / bytes - perByte[k]);
+}
+
+XMLDocument &DocumentPool::load(const char *filename) {
+	FILE *fp = fopen(filename, "rb");
+	if (!fp) {
+		document.LoadFile(filename);	// reports the missing file
+		return document;
+	}
+	fseek(fp, 0, SEEK_END);
+	long bytes = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	setvbuf(fp, NULL, _IONBF, 0);	// read straight into the document's buffer
+	if (bytes > 0) {
+		document.ReservePools((int)(perByte[POOL_ELEMENTS] * bytes * HEADROOM),
+			(int)(perByte[POOL_ATTRIBUTES] * bytes * HEADROOM), (int)(perByte[POOL_TEXTS] * bytes * HEADROOM));
+	}
+	document.LoadFile(fp);	// clears the last file back into the pools first
+	fclose(fp);
+	if (document.ErrorID() == XML_SUCCESS)
+		learn(bytes);
+	return document;
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include "tinyxml2.h"
+
+/*
+ * Per-thread XMLDocument reused by every loadSVG() on that thread.
+ *
+ * Clear() hands the nodes of the last file back to the document's pools
+ * without freeing their blocks, so later files parse into memory that is
+ * already there. Before a file is loaded the pools are grown in one step to
+ * what its size predicts, from elements, attributes and texts per byte
+ * learned from the files loaded before, so a large SVG does not grow them a
+ * block at a time.
+ */
+class DocumentPool {
+private:
+	enum { POOL_ELEMENTS, POOL_ATTRIBUTES, POOL_TEXTS, POOL_COUNT };
+
+	tinyxml2::XMLDocument document;
+	double perByte[POOL_COUNT];	// nodes of each kind per byte of input, learned
+
+	DocumentPool();
+	DocumentPool(const DocumentPool &) = delete;
+	DocumentPool &operator=(const DocumentPool &) = delete;
+
+	void learn(long bytes);
+
+public:
+	static DocumentPool &local();	// this thread's pool
+
+	// Loads filename into the pooled document; errors are reported by the document.
+	tinyxml2::XMLDocument &load(const char *filename);
+};
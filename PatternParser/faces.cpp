@@ -0,0 +1,245 @@
+#include "faces.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include "predicates.h"
+#include "radixsort.h"
+#include "threadpool.h"
+
+typedef std::atomic<unsigned long long> BitWord;
+
+// Successor of every half-edge around its face.
+static void buildNext(const NeighborArray &neighbors, ScratchVector<int> &next) {
+	int n = neighbors.size(), slots = neighbors.ids.size();
+	// both half-edges of an edge get the key (min, max), so sorting pairs them up
+	ScratchVector<unsigned long long> keys(slots);
+	ScratchVector<int> index(slots);
+	for (int v = 0; v < n; v++) {
+		for (int k = neighbors.offsets[v]; k < neighbors.offsets[v + 1]; k++) {
+			unsigned long long u = neighbors.ids[k];
+			keys[k] = u < (unsigned)v ? u << 32 | v : (unsigned long long)v << 32 | u;
+			index[k] = k;
+		}
+	}
+	radixSort(keys, index);
+	ScratchVector<int> twin(slots);
+	for (int k = 0; k + 1 < slots; k += 2) {
+		twin[index[k]] = index[k + 1];
+		twin[index[k + 1]] = index[k];
+	}
+
+	next.resize(slots);
+	for (int v = 0; v < n; v++) {
+		int first = neighbors.offsets[v], d = neighbors.degree(v);
+		for (int j = 0; j < d; j++)
+			next[first + j] = twin[first + (j + d - 1) % d];
+	}
+}
+
+// Sets bit h and returns whether it was set already.
+static bool claim(BitWord *visited, int h) {
+	unsigned long long bit = 1ull << (h & 63);
+	return (visited[h >> 6].fetch_or(bit, std::memory_order_relaxed) & bit) != 0;
+}
+
+/*
+ * Appends the cycles whose lowest slot lies in [first, last) to out. A start
+ * already claimed was passed by a walk from a lower slot of its cycle.
+ */
+static void walkFaces(const VertexArray &vts, const NeighborArray &neighbors, const ScratchVector<int> &next,
+	BitWord *visited, int first, int last, FaceArray &out) {
+	const float *x = vts.x.data(), *y = vts.y.data();
+	const int *ids = neighbors.ids.data();
+	for (int h = first; h < last; h++) {
+		if (claim(visited, h))
+			continue;
+		size_t start = out.vts.size();
+		double sum = 0, magnitude = 0;
+		bool lowest = true;
+		int e = h;
+		for (;;) {
+			int a = ids[e], b = ids[next[e]];
+			double p = (double)x[a] * y[b], q = (double)x[b] * y[a];
+			sum += p - q;
+			magnitude += fabs(p) + fabs(q);
+			out.vts.push_back(a);
+			e = next[e];
+			if (e == h)
+				break;
+			if (e < h) {
+				lowest = false;
+				break;
+			}
+			claim(visited, e);
+		}
+		if (!lowest) {
+			out.vts.resize(start);
+			continue;
+		}
+		int len = out.vts.size() - start;
+		out.offsets.push_back(out.vts.size());
+		out.area.push_back(sum);
+		int orientation = polygonOrientationExact(x, y, out.vts.data() + start, len, sum, magnitude);
+		out.orientation.push_back(orientation);
+		out.kind.push_back(orientation < 0 ? FaceInterior : FaceOuter);
+		out.parent.push_back(-1);
+	}
+}
+
+// Crossing-number test of whether (px, py), off the cycle, lies inside it.
+static bool insideCycle(const VertexArray &vts, const int *idx, int n, float px, float py) {
+	const float *x = vts.x.data(), *y = vts.y.data();
+	bool inside = false;
+	for (int i = 0; i < n; i++) {
+		int a = idx[i], b = idx[(i + 1) % n];
+		if ((y[a] > py) == (y[b] > py))
+			continue;
+		// the crossing is right of p when p is left of an upward edge or right of a downward one
+		int side = orient2d(x[a], y[a], x[b], y[b], px, py);
+		if (y[b] > y[a] ? side > 0 : side < 0)
+			inside = !inside;
+	}
+	return inside;
+}
+
+/*
+ * Every cycle that is not an interior face is the outside of one connected
+ * piece of the pattern. It is a hole of the smallest interior face of
+ * another piece around its first vertex, found through a grid over the face
+ * bounding boxes, and an outer boundary when there is none.
+ */
+static void attachHoles(const VertexArray &vts, const NeighborArray &neighbors, FaceArray &faces) {
+	int n = faces.size();
+	ScratchVector<int> outside, interior;
+	for (int f = 0; f < n; f++)
+		(faces.kind[f] == FaceInterior ? interior : outside).push_back(f);
+	if (outside.size() < 2 || interior.empty())
+		return;	// a single piece cannot lie inside itself
+
+	// piece of every vertex
+	int nv = neighbors.size();
+	ScratchVector<int> piece(nv, -1), queue;
+	for (int seed = 0; seed < nv; seed++) {
+		if (piece[seed] >= 0) continue;
+		piece[seed] = seed;
+		queue.assign(1, seed);
+		for (size_t i = 0; i < queue.size(); i++) {
+			for (const int *k = neighbors.begin(queue[i]); k != neighbors.end(queue[i]); k++) {
+				if (piece[*k] >= 0) continue;
+				piece[*k] = seed;
+				queue.push_back(*k);
+			}
+		}
+	}
+
+	int m = interior.size();
+	ScratchVector<float> x0(m), y0(m), x1(m), y1(m);
+	for (int i = 0; i < m; i++) {
+		const int *k = faces.begin(interior[i]);
+		x0[i] = x1[i] = vts.x[*k];
+		y0[i] = y1[i] = vts.y[*k];
+		for (; k != faces.end(interior[i]); k++) {
+			x0[i] = std::min(x0[i], vts.x[*k]);
+			x1[i] = std::max(x1[i], vts.x[*k]);
+			y0[i] = std::min(y0[i], vts.y[*k]);
+			y1[i] = std::max(y1[i], vts.y[*k]);
+		}
+	}
+	float minX = *std::min_element(x0.begin(), x0.end()), maxX = *std::max_element(x1.begin(), x1.end());
+	float minY = *std::min_element(y0.begin(), y0.end()), maxY = *std::max_element(y1.begin(), y1.end());
+	int cells = std::max(1, std::min((int)sqrt((double)m), 256));
+	float cw = std::max(maxX - minX, 1e-6f) / cells, ch = std::max(maxY - minY, 1e-6f) / cells;
+	auto col = [&](float px) { return std::min(std::max((int)((px - minX) / cw), 0), cells - 1); };
+	auto row = [&](float py) { return std::min(std::max((int)((py - minY) / ch), 0), cells - 1); };
+
+	// faces overlapping every cell, counted then filled
+	ScratchVector<int> offsets(cells * cells + 1, 0);
+	for (int i = 0; i < m; i++)
+		for (int r = row(y0[i]); r <= row(y1[i]); r++)
+			for (int c = col(x0[i]); c <= col(x1[i]); c++)
+				offsets[r * cells + c + 1]++;
+	for (int t = 0; t < cells * cells; t++)
+		offsets[t + 1] += offsets[t];
+	ScratchVector<int> members(offsets.back());
+	ScratchVector<int> fill(offsets.begin(), offsets.end() - 1);
+	for (int i = 0; i < m; i++)
+		for (int r = row(y0[i]); r <= row(y1[i]); r++)
+			for (int c = col(x0[i]); c <= col(x1[i]); c++)
+				members[fill[r * cells + c]++] = i;
+
+	for (int f : outside) {
+		int v = *faces.begin(f);
+		float px = vts.x[v], py = vts.y[v];
+		if (px < minX || px > maxX || py < minY || py > maxY)
+			continue;
+		int t = row(py) * cells + col(px), best = -1;
+		for (int k = offsets[t]; k < offsets[t + 1]; k++) {
+			int i = members[k], g = interior[i];
+			if (px < x0[i] || px > x1[i] || py < y0[i] || py > y1[i])
+				continue;
+			if (piece[*faces.begin(g)] == piece[v])
+				continue;
+			if (best >= 0 && fabs(faces.area[g]) >= fabs(faces.area[best]))
+				continue;
+			if (insideCycle(vts, faces.begin(g), faces.length(g), px, py))
+				best = g;
+		}
+		if (best >= 0) {
+			faces.kind[f] = FaceHole;
+			faces.parent[f] = best;
+		}
+	}
+}
+
+void extractFaces(const VertexArray &vts, const NeighborArray &neighbors, FaceArray &out) {
+	out.clear();
+	ScratchVector<int> next;
+	buildNext(neighbors, next);
+	int slots = next.size();
+	ScratchVector<BitWord> visited((slots + 63) / 64);
+	walkFaces(vts, neighbors, next, visited.data(), 0, slots, out);
+	attachHoles(vts, neighbors, out);
+}
+
+void extractFacesParallel(const VertexArray &vts, const NeighborArray &neighbors, int threads, FaceArray &out) {
+	out.clear();
+	ScratchVector<int> next;
+	buildNext(neighbors, next);
+	int slots = next.size();
+	if (slots == 0)
+		return;
+	ScratchVector<BitWord> visited((slots + 63) / 64);
+
+	ThreadPool &pool = ThreadPool::shared(threads);
+	int chunks = std::min(slots, pool.size() * 8);
+	std::vector<FaceArray> found(chunks);
+	pool.parallelFor(chunks, [&](int c) {
+		int first = (int)((long long)slots * c / chunks);
+		int last = (int)((long long)slots * (c + 1) / chunks);
+		walkFaces(vts, neighbors, next, visited.data(), first, last, found[c]);
+	});
+
+	// chunks hold increasing slot ranges, so this keeps the faces by lowest slot
+	size_t faces = 0, total = 0;
+	for (const FaceArray &f : found) {
+		faces += f.size();
+		total += f.vts.size();
+	}
+	out.offsets.reserve(faces + 1);
+	out.vts.reserve(total);
+	out.area.reserve(faces);
+	out.orientation.reserve(faces);
+	out.kind.reserve(faces);
+	out.parent.reserve(faces);
+	for (const FaceArray &f : found) {
+		int base = out.vts.size();
+		for (size_t k = 1; k < f.offsets.size(); k++)
+			out.offsets.push_back(base + f.offsets[k]);
+		out.vts.insert(out.vts.end(), f.vts.begin(), f.vts.end());
+		out.area.insert(out.area.end(), f.area.begin(), f.area.end());
+		out.orientation.insert(out.orientation.end(), f.orientation.begin(), f.orientation.end());
+		out.kind.insert(out.kind.end(), f.kind.begin(), f.kind.end());
+		out.parent.insert(out.parent.end(), f.parent.begin(), f.parent.end());
+	}
+	attachHoles(vts, neighbors, out);
+}
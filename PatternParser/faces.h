@@ -0,0 +1,31 @@
+#pragma once
+#include "soa.h"
+
+/*
+ * Face extraction over half-edges.
+ *
+ * Slot k of row v in a NeighborArray, holding neighbor u, is the half-edge
+ * u -> v. With the rows sorted by decreasing angle, the half-edge that
+ * follows u -> v around its face is v -> w, w being the neighbor just
+ * before u in row v. The faces are the cycles of that successor map, every
+ * half-edge lying on exactly one; each comes out listing the origins of its
+ * half-edges, starting from its lowest slot, with its signed area summed
+ * during the walk. Cycles are numbered by their lowest slot.
+ *
+ * The walk also classifies them (FACE_KIND): negative ones are interior
+ * faces, every other one is the outside of a connected piece. A piece
+ * inside a face of another piece, like a cut-out island, has its outside
+ * attached to the smallest such face as a hole by point location; the rest
+ * are outer boundaries.
+ */
+
+void extractFaces(const VertexArray &vts, const NeighborArray &neighbors, FaceArray &out);
+
+/*
+ * Same result as extractFaces(), but ranges of slots are walked on the
+ * shared thread pool. A walk claims the half-edges it passes in an atomic
+ * visited bitmap and gives up on reaching a slot below its start, so only
+ * the walk from a cycle's lowest slot emits it and the numbering does not
+ * depend on the number of threads.
+ */
+void extractFacesParallel(const VertexArray &vts, const NeighborArray &neighbors, int threads, FaceArray &out);
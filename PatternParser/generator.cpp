@@ -0,0 +1,221 @@
+#include "generator.h"
+#include <random>
+
+static const float FOLD_ANGLE = 3.14159265358979f;	// opacity 1 in the SVG
+
+static void addCrease(vector<Edge> &out, float x1, float y1, float x2, float y2, TYPE type) {
+	Vertice v1(x1, y1);
+	Vertice v2(x2, y2);
+	float angle = 0;
+	if (type == Mountain) angle = -FOLD_ANGLE;
+	if (type == Valley) angle = FOLD_ANGLE;
+	out.push_back(Edge(v1, v2, angle, type));
+}
+
+static void addBorder(vector<Edge> &out, float w, float h) {
+	addCrease(out, 0, 0, w, 0, Border);
+	addCrease(out, w, 0, w, h, Border);
+	addCrease(out, w, h, 0, h, Border);
+	addCrease(out, 0, h, 0, 0, Border);
+}
+
+/*
+ * Miura-ori: straight horizontal pleats and zig-zag vertical creases,
+ * drawn as one segment per cell side.
+ */
+static void miuraOri(vector<Edge> &out, int n, float cell) {
+	float shift = cell * 0.25f;
+	for (int j = 0; j <= n; j++) {
+		float y = j * cell;
+		float x0 = (j % 2) ? shift : 0;
+		for (int i = 0; i < n; i++) {
+			TYPE type = (j == 0 || j == n) ? Border : ((j % 2) ? Valley : Mountain);
+			addCrease(out, i * cell + x0, y, (i + 1) * cell + x0, y, type);
+		}
+	}
+	for (int i = 0; i <= n; i++) {
+		for (int j = 0; j < n; j++) {
+			float x1 = i * cell + ((j % 2) ? shift : 0);
+			float x2 = i * cell + (((j + 1) % 2) ? shift : 0);
+			TYPE type = (i == 0 || i == n) ? Border : (((i + j) % 2) ? Valley : Mountain);
+			addCrease(out, x1, j * cell, x2, (j + 1) * cell, type);
+		}
+	}
+}
+
+// Clips the ray p + t*d (t > 0) to the box [x0,x1]x[y0,y1] and returns the exit point.
+static void rayToBox(float px, float py, float dx, float dy,
+	float x0, float y0, float x1, float y1, float &ex, float &ey) {
+	float t = 1e30f;
+	if (dx > 0) t = min(t, (x1 - px) / dx);
+	if (dx < 0) t = min(t, (x0 - px) / dx);
+	if (dy > 0) t = min(t, (y1 - py) / dy);
+	if (dy < 0) t = min(t, (y0 - py) / dy);
+	ex = px + t * dx;
+	ey = py + t * dy;
+}
+
+/*
+ * Square twists: a rotated square in every cell whose sides are extended as
+ * pleats up to the cell boundary. The cell grid is drawn as full-length
+ * lines, so every pleat ends in a T-junction that has to be split.
+ */
+static void squareTwist(vector<Edge> &out, int n, float cell) {
+	float size = n * cell;
+	for (int k = 1; k < n; k++) {
+		addCrease(out, k * cell, 0, k * cell, size, Valley);
+		addCrease(out, 0, k * cell, size, k * cell, Valley);
+	}
+
+	const float theta = 0.3926991f;	// 22.5 degrees
+	float h = cell * 0.2f;
+	for (int j = 0; j < n; j++) {
+		for (int i = 0; i < n; i++) {
+			float x0 = i * cell, y0 = j * cell;
+			float cx = x0 + cell * 0.5f, cy = y0 + cell * 0.5f;
+			float px[4], py[4];
+			for (int c = 0; c < 4; c++) {
+				float a = theta + c * 1.5707963f;
+				px[c] = cx + h * 1.4142136f * cosf(a);
+				py[c] = cy + h * 1.4142136f * sinf(a);
+			}
+			for (int c = 0; c < 4; c++) {
+				int d = (c + 1) % 4;
+				addCrease(out, px[c], py[c], px[d], py[d], Mountain);
+				float ex, ey;
+				rayToBox(px[d], py[d], px[d] - px[c], py[d] - py[c], x0, y0, x0 + cell, y0 + cell, ex, ey);
+				addCrease(out, px[d], py[d], ex, ey, Valley);
+			}
+		}
+	}
+}
+
+/*
+ * Resch-style triangle tessellation: a triangular lattice drawn as long
+ * lines in three directions, plus a mountain star in every upward triangle
+ * of the n x n rhombus.
+ */
+static void resch(vector<Edge> &out, int n, float cell) {
+	const float ax = cell, ay = 0;
+	const float bx = cell * 0.5f, by = cell * 0.8660254f;
+	for (int k = 0; k <= n; k++) {
+		TYPE type = (k == 0 || k == n) ? Border : Valley;
+		addCrease(out, k * bx, k * by, k * bx + n * ax, k * by + n * ay, type);
+		addCrease(out, k * ax, k * ay, k * ax + n * bx, k * ay + n * by, type);
+	}
+	for (int k = 1; k < 2 * n; k++) {
+		int i0 = max(0, k - n), i1 = min(k, n);
+		int j0 = k - i0, j1 = k - i1;
+		addCrease(out, i0 * ax + j0 * bx, i0 * ay + j0 * by, i1 * ax + j1 * bx, i1 * ay + j1 * by, Valley);
+	}
+	for (int j = 0; j < n; j++) {
+		for (int i = 0; i < n; i++) {
+			float x[3] = { i * ax + j * bx, (i + 1) * ax + j * bx, i * ax + (j + 1) * bx };
+			float y[3] = { i * ay + j * by, (i + 1) * ay + j * by, i * ay + (j + 1) * by };
+			float cx = (x[0] + x[1] + x[2]) / 3.0f;
+			float cy = (y[0] + y[1] + y[2]) / 3.0f;
+			for (int c = 0; c < 3; c++)
+				addCrease(out, cx, cy, x[c], y[c], Mountain);
+		}
+	}
+}
+
+/*
+ * Random chords: n lines from the left to the right border and n from the
+ * top to the bottom one, so roughly n*n crossings.
+ */
+static void randomLines(vector<Edge> &out, int n, float cell, unsigned seed) {
+	float size = n * cell;
+	mt19937 rng(seed);
+	// mt19937 output is portable, uniform_real_distribution is not
+	auto uniform = [&rng]() { return (rng() >> 8) * (1.0f / 16777216.0f); };
+	addBorder(out, size, size);
+	for (int k = 0; k < n; k++) {
+		TYPE type = (rng() & 1) ? Mountain : Valley;
+		addCrease(out, 0, uniform() * size, size, uniform() * size, type);
+		type = (rng() & 1) ? Mountain : Valley;
+		addCrease(out, uniform() * size, 0, uniform() * size, size, type);
+	}
+}
+
+const char *tessellationName(TESSELLATION kind) {
+	static const char *names[] = { "miura", "twist", "resch", "random" };
+	return kind < TESSELLATION_COUNT ? names[kind] : "unknown";
+}
+
+bool tessellationFromName(const string &name, TESSELLATION &kind) {
+	for (int k = 0; k < TESSELLATION_COUNT; k++) {
+		if (name == tessellationName((TESSELLATION)k)) {
+			kind = (TESSELLATION)k;
+			return true;
+		}
+	}
+	return false;
+}
+
+vector<Edge> generateTessellation(TESSELLATION kind, int n, float cell, unsigned seed) {
+	vector<Edge> out;
+	if (n < 1) return out;
+	switch (kind) {
+	case MiuraOri:
+		miuraOri(out, n, cell);
+		break;
+	case SquareTwist:
+		addBorder(out, n * cell, n * cell);
+		squareTwist(out, n, cell);
+		break;
+	case Resch:
+		resch(out, n, cell);
+		break;
+	case RandomLines:
+		randomLines(out, n, cell, seed);
+		break;
+	default:
+		break;
+	}
+	return out;
+}
+
+static const char *strokeForType(TYPE type) {
+	switch (type) {
+	case Border: return "#000000";
+	case Mountain: return "#ff0000";
+	case Valley: return "#0000ff";
+	case Cut: return "#00ff00";
+	case Triangulation: return "#ffff00";
+	case Hinge: return "#ff00ff";
+	default: return NULL;
+	}
+}
+
+void writeSVG(ostream &out, const vector<Edge> &creases) {
+	float x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+	for (size_t i = 0; i < creases.size(); i++) {
+		const Edge &e = creases[i];
+		if (i == 0) {
+			x0 = x1 = e.v1.x;
+			y0 = y1 = e.v1.y;
+		}
+		x0 = min(x0, min(e.v1.x, e.v2.x));
+		y0 = min(y0, min(e.v1.y, e.v2.y));
+		x1 = max(x1, max(e.v1.x, e.v2.x));
+		y1 = max(y1, max(e.v1.y, e.v2.y));
+	}
+
+	streamsize precision = out.precision(9);	// round-trips a float
+	out << "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+		<< "<svg version=\"1.1\" xmlns=\"http://www.w3.org/2000/svg\" x=\"0px\" y=\"0px\""
+		<< " width=\"" << x1 - x0 << "px\" height=\"" << y1 - y0 << "px\""
+		<< " viewBox=\"" << x0 << " " << y0 << " " << x1 - x0 << " " << y1 - y0 << "\">\n";
+	for (const Edge &e : creases) {
+		const char *stroke = strokeForType(e.type);
+		if (!stroke) continue;
+		out << "<line fill=\"none\" stroke=\"" << stroke << "\"";
+		if (e.type == Mountain || e.type == Valley)
+			out << " opacity=\"" << fabsf(e.angle) / FOLD_ANGLE << "\"";
+		out << " x1=\"" << e.v1.x << "\" y1=\"" << e.v1.y
+			<< "\" x2=\"" << e.v2.x << "\" y2=\"" << e.v2.y << "\"/>\n";
+	}
+	out << "</svg>\n";
+	out.precision(precision);
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <iostream>
+#include <vector>
+#include <string>
+
+#include "pattern.h"
+using namespace std;
+
+/*
+ * Synthetic crease patterns for scaling experiments.
+ *
+ * Every generator builds an n x n tessellation of square-ish cells of size
+ * `cell` and returns its creases, border included. The result can be fed to
+ * Pattern directly or written out as an SVG the parser understands.
+ */
+
+enum TESSELLATION {
+	MiuraOri, SquareTwist, Resch, RandomLines, TESSELLATION_COUNT
+};
+
+const char *tessellationName(TESSELLATION kind);
+bool tessellationFromName(const string &name, TESSELLATION &kind);
+
+vector<Edge> generateTessellation(TESSELLATION kind, int n, float cell = 100.0f, unsigned seed = 1);
+
+void writeSVG(ostream &out, const vector<Edge> &creases);
@@ -9,173 +9,228 @@
 using namespace std;
 
 
-// BASIC GEOMETRY 
+// BASIC GEOMETRY
+//
+// Header-only, templated over a scalar policy: Scalar is what coordinates
+// are converted to and computed in, Real what lengths and angles come back
+// as. Products of two coordinates stay in Scalar, so in fixed point they
+// carry twice the fraction bits; the kernel only compares and signs them.
+// The kernel is generic, the parser is not: Pattern stores float vertices
+// and its intersection kernels and predicates are float only, so there is
+// no Pattern per policy. ParseOptions::anglePrecision picks the policy for
+// the neighbour angle sort and the quad diagonal and nothing else.
+
+struct FloatPolicy {
+	typedef float Scalar;
+	typedef float Real;
+	static Scalar fromFloat(float v) { return v; }
+	static Real toReal(Scalar v) { return v; }
+};
+
+struct DoublePolicy {
+	typedef double Scalar;
+	typedef double Real;
+	static Scalar fromFloat(float v) { return v; }
+	static Real toReal(Scalar v) { return v; }
+};
+
+// 64-bit fixed point on a 1/1024 grid, the grid snap.h rounds to. Rounding
+// moves points that are not on that grid, which can swap the angle order of
+// close neighbours, so the parser does not offer it for float input.
+struct FixedPolicy {
+	typedef long long Scalar;
+	typedef double Real;
+	static const int FRACTION_BITS = 10;
+	static Scalar fromFloat(float v) { return llround(ldexp((double)v, FRACTION_BITS)); }
+	static Real toReal(Scalar v) { return ldexp((double)v, -FRACTION_BITS); }
+};
 
 // Utilities
 
 const float EPS = 0.000001f;
 const float PI_F = 3.14159265358979f;
 
-float sum(float a, float b) {
+template <class T>
+inline T sum(T a, T b) {
 	return a + b;
 }
 
-float min(float a, float b) {
+inline float min(float a, float b) {
 	return a < b ? a : b;
 }
 
-float max(float a, float b) {
+inline float max(float a, float b) {
 	return a > b ? a : b;
 }
 
-int sign(float x) {
+template <class T>
+inline int sign(T x) {
 	return (x > 0) ? 1 : ((x < 0) ? -1 : 0);
 }
 
 
 
 // 
-struct Vector2 {
-	float x, y;
-	Vector2(Vertice v)
-		:x(v.x), y(v.y) {}
-	Vector2()
-		:x(0.0f), y(0.0f) {}
-	bool operator==(Vector2 &other) {
+template <class P>
+struct Vector2T {
+	typedef typename P::Scalar Scalar;
+	Scalar x, y;
+	Vector2T(Vertice v)
+		:x(P::fromFloat(v.x)), y(P::fromFloat(v.y)) {}
+	Vector2T(Scalar _x, Scalar _y)
+		:x(_x), y(_y) {}
+	Vector2T()
+		:x(0), y(0) {}
+	bool operator==(const Vector2T &other) const {
 		return (other.x == this->x) && (other.y == this->y);
 	}
-	float distance(Vector2 &other) {
-		return sqrtf(powf((other.x - this->x), 2) + powf((other.y - this->y), 2));
+	typename P::Real distance(const Vector2T &other) const {
+		typename P::Real dx = P::toReal(other.x - this->x), dy = P::toReal(other.y - this->y);
+		return sqrt(dx * dx + dy * dy);
 	}
 };
 
-struct Vector3 {
-	float x, y, z;
-	Vector3(float _x, float _y, float _z)
+template <class P>
+struct Vector3T {
+	typedef typename P::Scalar Scalar;
+	Scalar x, y, z;
+	Vector3T(Scalar _x, Scalar _y, Scalar _z)
 		:x(_x), y(_y), z(_z) {}
-	Vector3(Vertice v)
-		:x(v.x), y(v.y), z(v.z) {}
-	bool operator ==(const Vector3 &a) const {
+	Vector3T(Vertice v)
+		:x(P::fromFloat(v.x)), y(P::fromFloat(v.y)), z(P::fromFloat(v.z)) {}
+	bool operator ==(const Vector3T &a) const {
 		return x == a.x && y == a.y && z == a.z;
 	}
-	bool operator !=(const Vector3 &a) const {
+	bool operator !=(const Vector3T &a) const {
 		return x != a.x || y != a.y || z != a.z;
 	}
 	// 
-	Vector3 zero() {
-		x = y = z = 0.0f;
+	Vector3T zero() {
+		x = y = z = 0;
+		return *this;
 	}
 	// ظ
-	Vector3 operator -() const { 
-		return Vector3(-x, -y, -z);
+	Vector3T operator -() const {
+		return Vector3T(-x, -y, -z);
 	}
 
 	// رˡ
-	Vector3 operator *(float a) const {
-		return Vector3(x*a, y*a, z*a);
+	Vector3T operator *(Scalar a) const {
+		return Vector3T(x*a, y*a, z*a);
 	}
-	Vector3 operator /(float a) const {
-		float oneOverA = 1.0f / a; // ûжԳ
-		return Vector3(x*oneOverA, y*oneOverA, z*oneOverA);
+	Vector3T operator /(Scalar a) const {
+		return Vector3T(x / a, y / a, z / a); // ûжԳ
 	}
-	
-	
+
+
 	// أ=
-	Vector3 &operator +=(const Vector3 &a) {
+	Vector3T &operator +=(const Vector3T &a) {
 		x += a.x; y += a.y; z += a.z;
 		return *this;
 	}
-	Vector3 &operator -= (const Vector3 &a) {
+	Vector3T &operator -= (const Vector3T &a) {
 		x -= a.x; y -= a.y; z -= a.z;
 		return *this;
 	}
-	Vector3 &operator *=(float a) {
+	Vector3T &operator *=(Scalar a) {
 		x *= a; y *= a; z *= a;
 		return *this;
 	}
-	Vector3 &operator /=(float a) {
-		float oneOverA = 1.0f / a;
-		x *= oneOverA; y *= oneOverA; z *= oneOverA;
+	Vector3T &operator /=(Scalar a) {
+		x /= a; y /= a; z /= a;
 		return *this;
 	}
 	// ׼
 	void normalize() {
-		float magSq = x * x + y * y + z * z;
-		if (magSq > 0.0f) { // 
-			float oneOverMag = 1.0f / sqrt(magSq);
-			x *= oneOverMag;
-			y *= oneOverMag;
-			z *= oneOverMag;
+		Scalar magSq = x * x + y * y + z * z;
+		if (magSq > 0) { // 
+			typename P::Real oneOverMag = 1 / sqrt((typename P::Real)magSq);
+			x = (Scalar)(x * oneOverMag);
+			y = (Scalar)(y * oneOverMag);
+			z = (Scalar)(z * oneOverMag);
 		}
 	}
 	// ˣس˷
-	float operator *(const Vector3 &a) const {
+	Scalar operator *(const Vector3T &a) const {
 		return x * a.x + y * a.y + z * a.z;
 	}
 
-	float lengthSq() {
+	Scalar lengthSq() const {
 		return x * x + y * y + z * z;
 	}
 };
 
+typedef Vector2T<FloatPolicy> Vector2;
+typedef Vector3T<FloatPolicy> Vector3;
+
 // ؼӼ
-Vector3 operator +(const Vector3 &a, const Vector3 &b) {
-	return Vector3(b.x + a.x, b.y + a.y, b.z + a.z);
+template <class P>
+inline Vector3T<P> operator +(const Vector3T<P> &a, const Vector3T<P> &b) {
+	return Vector3T<P>(b.x + a.x, b.y + a.y, b.z + a.z);
 }
-Vector3 operator -(const Vector3 &b, const Vector3 &a) {
-	return Vector3(b.x - a.x, b.y - a.y, b.z - a.z);
+template <class P>
+inline Vector3T<P> operator -(const Vector3T<P> &b, const Vector3T<P> &a) {
+	return Vector3T<P>(b.x - a.x, b.y - a.y, b.z - a.z);
 }
 
 // ģƽ
-float Magsq(const Vector3 &a) {
+template <class P>
+inline typename P::Scalar Magsq(const Vector3T<P> &a) {
 	return a.x*a.x + a.y*a.y + a.z*a.z;
 }
 
 // ģ
-float vectorMag(const Vector3 &a) {
-	return sqrt(Magsq(a));
+template <class P>
+inline typename P::Real vectorMag(const Vector3T<P> &a) {
+	typename P::Real x = P::toReal(a.x), y = P::toReal(a.y), z = P::toReal(a.z);
+	return sqrt(x*x + y*y + z*z);
 }
 // Ĳ
-Vector3 crossProduct(const Vector3 &a, const Vector3 &b) {
-	return Vector3(a.y*b.z - a.z*b.y, a.z*b.x - a.x*b.z, a.x*b.y - a.y*b.x);
+template <class P>
+inline Vector3T<P> crossProduct(const Vector3T<P> &a, const Vector3T<P> &b) {
+	return Vector3T<P>(a.y*b.z - a.z*b.y, a.z*b.x - a.x*b.z, a.x*b.y - a.y*b.x);
 }
 // ˷
-Vector3 operator *(float k, const Vector3 &v) {
-	return Vector3(k*v.x, k*v.y, k*v.z);
+template <class P>
+inline Vector3T<P> operator *(typename P::Scalar k, const Vector3T<P> &v) {
+	return Vector3T<P>(k*v.x, k*v.y, k*v.z);
 }
 // 
-float distance(const Vector3 &a, const Vector3 &b) {
-	float dx = a.x - b.x;
-	float dy = a.y - b.y;
-	float dz = a.z - b.z;
-	return sqrt(dx*dx + dy * dy + dz * dz);
+template <class P>
+inline typename P::Real distance(const Vector3T<P> &a, const Vector3T<P> &b) {
+	return vectorMag(a - b);
 }
 
-float ang2D(Vector3 &a) {
-	if (Magsq(a) < EPS)return 0.0f;
+template <class P>
+inline typename P::Real ang2D(const Vector3T<P> &a) {
+	if (Magsq(a) < EPS) return 0;
 	//if (a.y == 0) a.y = EPS;
 	//if (a.x == 0) a.x = EPS;
-	return atan2f(a.y, a.x);
+	return atan2(P::toReal(a.y), P::toReal(a.x));
 }
 
-Vector3 origin(0,0,0);
-bool sortByAngle(const Vector3 &a, const Vector3 &b) {
-	float ang1 = ang2D(a-origin);
-	float ang2 = ang2D(b-origin);
-	return ang1 > ang2;
-}
+// Orders points around o by decreasing angle.
+template <class P>
+struct AngleGreater {
+	Vector3T<P> o;
+	AngleGreater(const Vector3T<P> &origin) :o(origin) {}
+	bool operator()(const Vector3T<P> &a, const Vector3T<P> &b) const {
+		return ang2D(a - o) > ang2D(b - o);
+	}
+};
 
-float twiceSignedArea(vector<Vector3> points) {
+template <class P>
+inline typename P::Scalar twiceSignedArea(const vector<Vector3T<P>> &points) {
 	/*
 	 * Returns twice signed area of polygon defined by input points.
 	 * Calculates and sums twice signed area of triangles in a fan from the first
 	 * vertex.
 	 */
 	int n = points.size();
-	float result = 0.0f;
+	typename P::Scalar result = 0;
 	for (int i = 0; i < n; i++) {
-		Vector3 v0 = points[i];
-		Vector3 v1 = points[(i + 1) % n];
+		const Vector3T<P> &v0 = points[i];
+		const Vector3T<P> &v1 = points[(i + 1) % n];
 		result += v0.x * v1.y - v1.x * v0.y;
 	}
 	return result;
@@ -184,17 +239,25 @@ float twiceSignedArea(vector<Vector3> points) {
 	//	v0[0] * v1[1] - v1[0] * v0[1]
 	//	).reduce(geom.sum)
 }
-int polygonOrientation(vector<Vector3> points) {
+// Same sum over a polygon given as indices into coordinate arrays.
+template <class P>
+inline typename P::Scalar twiceSignedArea(const float *x, const float *y, const int *idx, int n) {
+	typename P::Scalar result = 0;
+	for (int i = 0; i < n; i++) {
+		int a = idx[i];
+		int b = idx[(i + 1) % n];
+		result += P::fromFloat(x[a]) * P::fromFloat(y[b]) - P::fromFloat(x[b]) * P::fromFloat(y[a]);
+	}
+	return result;
+}
+
+template <class P>
+inline int polygonOrientation(const vector<Vector3T<P>> &points) {
 	/*
 	 * Returns the orientation of the 2D polygon defined by the input points.
 	 * -1 for counterclockwise, +1 for clockwise
 	 * via computing sum of signed areas of triangles formed with origin
 	 */
-	
+
 	return sign(twiceSignedArea(points));
 }
-
-
-
-
-
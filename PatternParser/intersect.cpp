@@ -0,0 +1,448 @@
+#include "intersect.h"
+#include "threadpool.h"
+#include "predicates.h"
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define HAVE_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_SSE __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_SSE
+#define TARGET_AVX2
+#endif
+
+const char *simdLevelName(SIMD_LEVEL level) {
+	static const char *names[] = { "scalar", "sse", "avx2" };
+	return level < SIMD_LEVEL_COUNT ? names[level] : "unknown";
+}
+
+bool simdLevelFromName(const char *name, SIMD_LEVEL &level) {
+	for (int i = 0; i < SIMD_LEVEL_COUNT; i++) {
+		if (strcmp(name, simdLevelName((SIMD_LEVEL)i)) == 0) {
+			level = (SIMD_LEVEL)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+static SIMD_LEVEL detectSimd() {
+#if defined(HAVE_X86) && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+	if (osxsave && avx && (_xgetbv(0) & 6) == 6) {
+		__cpuidex(info, 7, 0);
+		if (info[1] & (1 << 5))
+			return SimdAVX2;
+	}
+	return SimdSSE;
+#elif defined(HAVE_X86)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return SimdAVX2;
+	if (__builtin_cpu_supports("sse2"))
+		return SimdSSE;
+	return SimdScalar;
+#else
+	return SimdScalar;
+#endif
+}
+
+SIMD_LEVEL simdSupported() {
+	static SIMD_LEVEL supported = detectSimd();
+	return supported;
+}
+
+static std::atomic<int> levelOverride(-1);
+
+SIMD_LEVEL simdLevel() {
+	int level = levelOverride;
+	return level < 0 ? simdSupported() : (SIMD_LEVEL)level;
+}
+
+void setSimdLevel(SIMD_LEVEL level) {
+	levelOverride = level < simdSupported() ? level : simdSupported();
+}
+
+void SegmentArray::add(float ax, float ay, float bx, float by) {
+	x0.push_back(ax);
+	y0.push_back(ay);
+	x1.push_back(bx);
+	y1.push_back(by);
+	length.push_back(sqrtf((bx - ax) * (bx - ax) + (by - ay) * (by - ay)));
+}
+
+void buildSegments(const VertexArray &vts, const EdgeArray &edges, SegmentArray &segs) {
+	int n = edges.size();
+	segs.clear();
+	segs.reserve(n);
+	for (int i = 0; i < n; i++) {
+		int a = edges.v0[i], b = edges.v1[i];
+		segs.add(vts.x[a], vts.y[a], vts.x[b], vts.y[b]);
+	}
+}
+
+// The query segment, broadcast to every lane.
+struct Query {
+	float x1, y1, x2, y2, dx1, dy1, len1, tol;
+	float minX, maxX, minY, maxY;	// bounding box grown by tol
+};
+
+/*
+ * The float denominator is trusted only while it is well above its rounding
+ * error, about 4 ulp of |dy2 dx1| + |dx2 dy1|. Below this fraction of that
+ * sum the lines are nearly parallel, t1/t2 would be mostly noise, and the
+ * pair goes to intersectExact() instead - unless the bounding boxes are
+ * apart, which rules out a hit for parallel grid lines cheaply.
+ */
+const float NEAR_PARALLEL = 1.0f / 4096;
+
+static bool boxesApart(const Query &q, float x3, float y3, float x4, float y4) {
+	return (x3 < q.minX && x4 < q.minX) || (x3 > q.maxX && x4 > q.maxX)
+		|| (y3 < q.minY && y4 < q.minY) || (y3 > q.maxY && y4 > q.maxY);
+}
+
+// Slow path for nearly parallel pairs: exact determinants, double classification.
+static bool intersectExact(const Query &q, const SegmentArray &segs, int c, float &t1, float &t2) {
+	double a, b;
+	t1 = t2 = 0;
+	if (!lineIntersectExact(q.x1, q.y1, q.x2, q.y2, segs.x0[c], segs.y0[c], segs.x1[c], segs.y1[c], a, b))
+		return false;	// exactly parallel; overlaps are not crossings
+	double len1 = q.len1, len2 = segs.length[c], tol = q.tol;
+	double d1 = a * len1, d2 = b * len2;
+	if (d1 < -tol || d1 > len1 + tol) return false;
+	if (d2 < -tol || d2 > len2 + tol) return false;
+	t1 = (float)a;
+	t2 = (float)b;
+	bool int1 = d1 > tol && d1 < len1 - tol;
+	bool int2 = d2 > tol && d2 < len2 - tol;
+	return int1 || int2;
+}
+
+// http://paulbourke.net/geometry/pointlineplane/
+static bool intersectOne(const Query &q, const SegmentArray &segs, int c, float &t1, float &t2) {
+	float x3 = segs.x0[c], y3 = segs.y0[c];
+	float dx2 = segs.x1[c] - x3, dy2 = segs.y1[c] - y3;
+	float len2 = segs.length[c];
+
+	float denom = dy2 * q.dx1 - dx2 * q.dy1;
+	if (fabsf(denom) <= (fabsf(dy2 * q.dx1) + fabsf(dx2 * q.dy1)) * NEAR_PARALLEL) {
+		if (boxesApart(q, x3, y3, segs.x1[c], segs.y1[c])) {
+			t1 = t2 = 0;
+			return false;
+		}
+		return intersectExact(q, segs, c, t1, t2);
+	}
+	float rx = q.x1 - x3, ry = q.y1 - y3;
+	t1 = (dx2 * ry - dy2 * rx) / denom;
+	t2 = (q.dx1 * ry - q.dy1 * rx) / denom;
+
+	float d1 = t1 * q.len1, d2 = t2 * len2;
+	if (d1 < -q.tol || d1 > q.len1 + q.tol) return false;
+	if (d2 < -q.tol || d2 > len2 + q.tol) return false;
+	bool int1 = d1 > q.tol && d1 < q.len1 - q.tol;
+	bool int2 = d2 > q.tol && d2 < len2 - q.tol;
+	return int1 || int2;
+}
+
+static unsigned blockScalar(const Query &q, const SegmentArray &segs, int first, int count, float *t1, float *t2) {
+	unsigned mask = 0;
+	for (int k = 0; k < count; k++) {
+		if (intersectOne(q, segs, first + k, t1[k], t2[k]))
+			mask |= 1u << k;
+	}
+	return mask;
+}
+
+#ifdef HAVE_X86
+// Reruns the lanes the vector filter flagged through the exact path.
+static unsigned exactLanes(const Query &q, const SegmentArray &segs, int first, int lanes, float *t1, float *t2) {
+	unsigned mask = 0;
+	for (int k = 0; lanes; k++, lanes >>= 1) {
+		if ((lanes & 1) && intersectExact(q, segs, first + k, t1[k], t2[k]))
+			mask |= 1u << k;
+	}
+	return mask;
+}
+
+TARGET_SSE
+static unsigned blockSSE(const Query &q, const SegmentArray &segs, int first, int count, float *t1, float *t2) {
+	const __m128 x1 = _mm_set1_ps(q.x1), y1 = _mm_set1_ps(q.y1);
+	const __m128 dx1 = _mm_set1_ps(q.dx1), dy1 = _mm_set1_ps(q.dy1);
+	const __m128 len1 = _mm_set1_ps(q.len1), tol = _mm_set1_ps(q.tol), negTol = _mm_set1_ps(-q.tol);
+	const __m128 lo1 = _mm_set1_ps(q.len1 - q.tol), hi1 = _mm_set1_ps(q.len1 + q.tol);
+	const __m128 nearParallel = _mm_set1_ps(NEAR_PARALLEL);
+	const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+	const __m128 minX = _mm_set1_ps(q.minX), maxX = _mm_set1_ps(q.maxX);
+	const __m128 minY = _mm_set1_ps(q.minY), maxY = _mm_set1_ps(q.maxY);
+
+	unsigned mask = 0;
+	int k = 0;
+	for (; k + 4 <= count; k += 4) {
+		int c = first + k;
+		__m128 x3 = _mm_loadu_ps(&segs.x0[c]), y3 = _mm_loadu_ps(&segs.y0[c]);
+		__m128 dx2 = _mm_sub_ps(_mm_loadu_ps(&segs.x1[c]), x3);
+		__m128 dy2 = _mm_sub_ps(_mm_loadu_ps(&segs.y1[c]), y3);
+		__m128 len2 = _mm_loadu_ps(&segs.length[c]);
+
+		__m128 p = _mm_mul_ps(dy2, dx1), r = _mm_mul_ps(dx2, dy1);
+		__m128 denom = _mm_sub_ps(p, r);
+		__m128 bound = _mm_mul_ps(_mm_add_ps(_mm_and_ps(p, absMask), _mm_and_ps(r, absMask)), nearParallel);
+		__m128 nearPar = _mm_cmple_ps(_mm_and_ps(denom, absMask), bound), exact = nearPar;
+		if (_mm_movemask_ps(nearPar)) {
+			__m128 x4 = _mm_loadu_ps(&segs.x1[c]), y4 = _mm_loadu_ps(&segs.y1[c]);
+			__m128 apart = _mm_or_ps(
+				_mm_or_ps(_mm_and_ps(_mm_cmplt_ps(x3, minX), _mm_cmplt_ps(x4, minX)),
+					_mm_and_ps(_mm_cmpgt_ps(x3, maxX), _mm_cmpgt_ps(x4, maxX))),
+				_mm_or_ps(_mm_and_ps(_mm_cmplt_ps(y3, minY), _mm_cmplt_ps(y4, minY)),
+					_mm_and_ps(_mm_cmpgt_ps(y3, maxY), _mm_cmpgt_ps(y4, maxY))));
+			exact = _mm_andnot_ps(apart, nearPar);
+		}
+		__m128 rx = _mm_sub_ps(x1, x3), ry = _mm_sub_ps(y1, y3);
+		__m128 a = _mm_div_ps(_mm_sub_ps(_mm_mul_ps(dx2, ry), _mm_mul_ps(dy2, rx)), denom);
+		__m128 b = _mm_div_ps(_mm_sub_ps(_mm_mul_ps(dx1, ry), _mm_mul_ps(dy1, rx)), denom);
+
+		__m128 d1 = _mm_mul_ps(a, len1), d2 = _mm_mul_ps(b, len2);
+		__m128 outside = _mm_or_ps(
+			_mm_or_ps(_mm_cmplt_ps(d1, negTol), _mm_cmpgt_ps(d1, hi1)),
+			_mm_or_ps(_mm_cmplt_ps(d2, negTol), _mm_cmpgt_ps(d2, _mm_add_ps(len2, tol))));
+		__m128 int1 = _mm_and_ps(_mm_cmpgt_ps(d1, tol), _mm_cmplt_ps(d1, lo1));
+		__m128 int2 = _mm_and_ps(_mm_cmpgt_ps(d2, tol), _mm_cmplt_ps(d2, _mm_sub_ps(len2, tol)));
+		// near-parallel lanes never come from the float path: t is 0 unless
+		// exactLanes() below fills it in
+		__m128 hit = _mm_andnot_ps(_mm_or_ps(outside, nearPar), _mm_or_ps(int1, int2));
+
+		_mm_storeu_ps(t1 + k, _mm_andnot_ps(nearPar, a));
+		_mm_storeu_ps(t2 + k, _mm_andnot_ps(nearPar, b));
+		mask |= (unsigned)_mm_movemask_ps(hit) << k;
+		mask |= exactLanes(q, segs, c, _mm_movemask_ps(exact), t1 + k, t2 + k) << k;
+	}
+	if (k < count)
+		mask |= blockScalar(q, segs, first + k, count - k, t1 + k, t2 + k) << k;
+	return mask;
+}
+
+TARGET_AVX2
+static unsigned blockAVX2(const Query &q, const SegmentArray &segs, int first, int count, float *t1, float *t2) {
+	const __m256 x1 = _mm256_set1_ps(q.x1), y1 = _mm256_set1_ps(q.y1);
+	const __m256 dx1 = _mm256_set1_ps(q.dx1), dy1 = _mm256_set1_ps(q.dy1);
+	const __m256 len1 = _mm256_set1_ps(q.len1), tol = _mm256_set1_ps(q.tol), negTol = _mm256_set1_ps(-q.tol);
+	const __m256 lo1 = _mm256_set1_ps(q.len1 - q.tol), hi1 = _mm256_set1_ps(q.len1 + q.tol);
+	const __m256 nearParallel = _mm256_set1_ps(NEAR_PARALLEL);
+	const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+	const __m256 minX = _mm256_set1_ps(q.minX), maxX = _mm256_set1_ps(q.maxX);
+	const __m256 minY = _mm256_set1_ps(q.minY), maxY = _mm256_set1_ps(q.maxY);
+
+	unsigned mask = 0;
+	int k = 0;
+	for (; k + 8 <= count; k += 8) {
+		int c = first + k;
+		__m256 x3 = _mm256_loadu_ps(&segs.x0[c]), y3 = _mm256_loadu_ps(&segs.y0[c]);
+		__m256 dx2 = _mm256_sub_ps(_mm256_loadu_ps(&segs.x1[c]), x3);
+		__m256 dy2 = _mm256_sub_ps(_mm256_loadu_ps(&segs.y1[c]), y3);
+		__m256 len2 = _mm256_loadu_ps(&segs.length[c]);
+
+		__m256 p = _mm256_mul_ps(dy2, dx1), r = _mm256_mul_ps(dx2, dy1);
+		__m256 denom = _mm256_sub_ps(p, r);
+		__m256 bound = _mm256_mul_ps(_mm256_add_ps(_mm256_and_ps(p, absMask), _mm256_and_ps(r, absMask)), nearParallel);
+		__m256 nearPar = _mm256_cmp_ps(_mm256_and_ps(denom, absMask), bound, _CMP_LE_OQ), exact = nearPar;
+		if (_mm256_movemask_ps(nearPar)) {
+			__m256 x4 = _mm256_loadu_ps(&segs.x1[c]), y4 = _mm256_loadu_ps(&segs.y1[c]);
+			__m256 apart = _mm256_or_ps(
+				_mm256_or_ps(
+					_mm256_and_ps(_mm256_cmp_ps(x3, minX, _CMP_LT_OQ), _mm256_cmp_ps(x4, minX, _CMP_LT_OQ)),
+					_mm256_and_ps(_mm256_cmp_ps(x3, maxX, _CMP_GT_OQ), _mm256_cmp_ps(x4, maxX, _CMP_GT_OQ))),
+				_mm256_or_ps(
+					_mm256_and_ps(_mm256_cmp_ps(y3, minY, _CMP_LT_OQ), _mm256_cmp_ps(y4, minY, _CMP_LT_OQ)),
+					_mm256_and_ps(_mm256_cmp_ps(y3, maxY, _CMP_GT_OQ), _mm256_cmp_ps(y4, maxY, _CMP_GT_OQ))));
+			exact = _mm256_andnot_ps(apart, nearPar);
+		}
+		__m256 rx = _mm256_sub_ps(x1, x3), ry = _mm256_sub_ps(y1, y3);
+		__m256 a = _mm256_div_ps(_mm256_sub_ps(_mm256_mul_ps(dx2, ry), _mm256_mul_ps(dy2, rx)), denom);
+		__m256 b = _mm256_div_ps(_mm256_sub_ps(_mm256_mul_ps(dx1, ry), _mm256_mul_ps(dy1, rx)), denom);
+
+		__m256 d1 = _mm256_mul_ps(a, len1), d2 = _mm256_mul_ps(b, len2);
+		__m256 outside = _mm256_or_ps(
+			_mm256_or_ps(_mm256_cmp_ps(d1, negTol, _CMP_LT_OQ), _mm256_cmp_ps(d1, hi1, _CMP_GT_OQ)),
+			_mm256_or_ps(_mm256_cmp_ps(d2, negTol, _CMP_LT_OQ),
+				_mm256_cmp_ps(d2, _mm256_add_ps(len2, tol), _CMP_GT_OQ)));
+		__m256 int1 = _mm256_and_ps(_mm256_cmp_ps(d1, tol, _CMP_GT_OQ), _mm256_cmp_ps(d1, lo1, _CMP_LT_OQ));
+		__m256 int2 = _mm256_and_ps(_mm256_cmp_ps(d2, tol, _CMP_GT_OQ),
+			_mm256_cmp_ps(d2, _mm256_sub_ps(len2, tol), _CMP_LT_OQ));
+		__m256 hit = _mm256_andnot_ps(_mm256_or_ps(outside, nearPar), _mm256_or_ps(int1, int2));
+
+		_mm256_storeu_ps(t1 + k, _mm256_andnot_ps(nearPar, a));
+		_mm256_storeu_ps(t2 + k, _mm256_andnot_ps(nearPar, b));
+		mask |= (unsigned)_mm256_movemask_ps(hit) << k;
+		mask |= exactLanes(q, segs, c, _mm256_movemask_ps(exact), t1 + k, t2 + k) << k;
+	}
+	if (k < count)
+		mask |= blockSSE(q, segs, first + k, count - k, t1 + k, t2 + k) << k;
+	return mask;
+}
+#endif
+
+unsigned intersectBlock(const SegmentArray &segs, int s, int first, int count, float tol, float *t1, float *t2) {
+	Query q;
+	q.x1 = segs.x0[s];
+	q.y1 = segs.y0[s];
+	q.x2 = segs.x1[s];
+	q.y2 = segs.y1[s];
+	q.dx1 = q.x2 - q.x1;
+	q.dy1 = q.y2 - q.y1;
+	q.minX = std::min(q.x1, q.x2) - tol;
+	q.maxX = std::max(q.x1, q.x2) + tol;
+	q.minY = std::min(q.y1, q.y2) - tol;
+	q.maxY = std::max(q.y1, q.y2) + tol;
+	q.len1 = segs.length[s];
+	q.tol = tol;
+
+	switch (simdLevel()) {
+#ifdef HAVE_X86
+	case SimdAVX2:
+		return blockAVX2(q, segs, first, count, t1, t2);
+	case SimdSSE:
+		return blockSSE(q, segs, first, count, t1, t2);
+#endif
+	default:
+		return blockScalar(q, segs, first, count, t1, t2);
+	}
+}
+
+// Calls found(a, b, t1, t2) for every crossing pair a > b of segs, in order.
+template <class F>
+static void crossingsAmong(const SegmentArray &segs, float tol, F found) {
+	int n = segs.size();
+	float t1[SEG_BLOCK], t2[SEG_BLOCK];
+	for (int a = 1; a < n; a++) {
+		for (int b = 0; b < a; b += SEG_BLOCK) {
+			int count = std::min(SEG_BLOCK, a - b);
+			unsigned hits = intersectBlock(segs, a, b, count, tol, t1, t2);
+			for (int k = 0; hits; k++, hits >>= 1) {
+				if (hits & 1)
+					found(a, b + k, t1[k], t2[k]);
+			}
+		}
+	}
+}
+
+void findCrossings(const SegmentArray &segs, float tol, ScratchVector<Crossing> &out) {
+	out.clear();
+	crossingsAmong(segs, tol, [&out](int a, int b, float t1, float t2) {
+		Crossing x = { a, b, t1, t2 };
+		out.push_back(x);
+	});
+}
+
+// Square grid over the segments' bounding boxes, grown by the tolerance.
+struct TileGrid {
+	float minX, minY, size;
+	int cols, rows;
+
+	int col(float x) const { return std::min(std::max((int)((x - minX) / size), 0), cols - 1); }
+	int row(float y) const { return std::min(std::max((int)((y - minY) / size), 0), rows - 1); }
+};
+
+const int TILE_EDGES = 32;	// edges per tile aimed for
+
+static TileGrid makeGrid(const SegmentArray &segs, float tol) {
+	int n = segs.size();
+	float minX = segs.x0[0], maxX = minX, minY = segs.y0[0], maxY = minY;
+	for (int i = 0; i < n; i++) {
+		minX = std::min(minX, std::min(segs.x0[i], segs.x1[i]));
+		maxX = std::max(maxX, std::max(segs.x0[i], segs.x1[i]));
+		minY = std::min(minY, std::min(segs.y0[i], segs.y1[i]));
+		maxY = std::max(maxY, std::max(segs.y0[i], segs.y1[i]));
+	}
+	TileGrid g;
+	g.minX = minX - tol;
+	g.minY = minY - tol;
+	float w = maxX - minX + 2 * tol, h = maxY - minY + 2 * tol;
+	int tiles = std::min(std::max(n / TILE_EDGES, 1), 256 * 256);
+	g.size = std::max(sqrtf(w * h / tiles), std::max(w, h) / 256);
+	if (!(g.size > 0))
+		g.size = 1;
+	g.cols = std::min((int)(w / g.size) + 1, 256);
+	g.rows = std::min((int)(h / g.size) + 1, 256);
+	return g;
+}
+
+void findCrossingsTiled(const SegmentArray &segs, float tol, int threads, ScratchVector<Crossing> &out) {
+	out.clear();
+	int n = segs.size();
+	if (n < 2)
+		return;
+	TileGrid g = makeGrid(segs, tol);
+	int tiles = g.cols * g.rows;
+
+	// tile range of every edge, then the edges of every tile in index order
+	ScratchVector<int> c0(n), c1(n), r0(n), r1(n);
+	ScratchVector<int> offsets(tiles + 1, 0);
+	for (int i = 0; i < n; i++) {
+		c0[i] = g.col(std::min(segs.x0[i], segs.x1[i]) - tol);
+		c1[i] = g.col(std::max(segs.x0[i], segs.x1[i]) + tol);
+		r0[i] = g.row(std::min(segs.y0[i], segs.y1[i]) - tol);
+		r1[i] = g.row(std::max(segs.y0[i], segs.y1[i]) + tol);
+		for (int r = r0[i]; r <= r1[i]; r++)
+			for (int c = c0[i]; c <= c1[i]; c++)
+				offsets[r * g.cols + c + 1]++;
+	}
+	for (int t = 0; t < tiles; t++)
+		offsets[t + 1] += offsets[t];
+	ScratchVector<int> members(offsets[tiles]);
+	ScratchVector<int> fill(offsets.begin(), offsets.end() - 1);
+	for (int i = 0; i < n; i++)
+		for (int r = r0[i]; r <= r1[i]; r++)
+			for (int c = c0[i]; c <= c1[i]; c++)
+				members[fill[r * g.cols + c]++] = i;
+
+	std::vector<std::vector<Crossing>> found(tiles);
+	ThreadPool::shared(threads).parallelFor(tiles, [&](int t) {
+		int first = offsets[t], m = offsets[t + 1] - first;
+		if (m < 2)
+			return;
+		const int *ids = &members[first];
+		SegmentArray local;
+		local.reserve(m);
+		for (int a = 0; a < m; a++) {
+			int i = ids[a];
+			local.x0.push_back(segs.x0[i]);
+			local.y0.push_back(segs.y0[i]);
+			local.x1.push_back(segs.x1[i]);
+			local.y1.push_back(segs.y1[i]);
+			local.length.push_back(segs.length[i]);
+		}
+
+		crossingsAmong(local, tol, [&](int a, int b, float t1, float t2) {
+			int i = ids[a], j = ids[b];
+			int owner = std::max(r0[i], r0[j]) * g.cols + std::max(c0[i], c0[j]);
+			if (owner != t)
+				return;
+			Crossing x = { i, j, t1, t2 };
+			found[t].push_back(x);
+		});
+	});
+
+	size_t total = 0;
+	for (const std::vector<Crossing> &f : found)
+		total += f.size();
+	out.reserve(total);
+	for (const std::vector<Crossing> &f : found)
+		out.insert(out.end(), f.begin(), f.end());
+	std::sort(out.begin(), out.end(), [](const Crossing &a, const Crossing &b) {
+		return a.e1 != b.e1 ? a.e1 < b.e1 : a.e2 < b.e2;
+	});
+}
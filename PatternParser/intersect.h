@@ -0,0 +1,64 @@
+#pragma once
+#include "arena.h"
+
+/*
+ * Batched segment-segment intersection.
+ *
+ * One segment is tested against a block of candidates at once: 8 lanes with
+ * AVX2, 4 with SSE, one at a time otherwise. The instruction set is picked
+ * at runtime from what the CPU supports. Every level does the same float
+ * operations in the same order, so they all report the same hits.
+ */
+
+enum SIMD_LEVEL {
+	SimdScalar, SimdSSE, SimdAVX2, SIMD_LEVEL_COUNT
+};
+
+const char *simdLevelName(SIMD_LEVEL level);
+bool simdLevelFromName(const char *name, SIMD_LEVEL &level);
+
+SIMD_LEVEL simdSupported();	// best level this CPU runs
+SIMD_LEVEL simdLevel();		// level in use, simdSupported() unless overridden
+void setSimdLevel(SIMD_LEVEL level);	// clamped to simdSupported()
+
+const int SEG_BLOCK = 8;	// most candidates handled per call
+
+// Segment endpoints and lengths, one entry per edge.
+struct SegmentArray {
+	AlignedVector<float> x0, y0, x1, y1, length;
+
+	size_t size() const { return x0.size(); }
+	void clear() { x0.clear(); y0.clear(); x1.clear(); y1.clear(); length.clear(); }
+	void reserve(size_t n) { x0.reserve(n); y0.reserve(n); x1.reserve(n); y1.reserve(n); length.reserve(n); }
+
+	void add(float ax, float ay, float bx, float by);
+};
+
+void buildSegments(const VertexArray &vts, const EdgeArray &edges, SegmentArray &segs);
+
+/*
+ * Tests segment s against segments [first, first + count) of segs, count at
+ * most SEG_BLOCK. Bit k of the result is set when s and segment first + k
+ * cross with at least one of them hit away from its endpoints, by more than
+ * tol along its length; t1[k] and t2[k] are then the crossing parameters on
+ * s and on the candidate. Nearly parallel pairs are decided with the exact
+ * predicates of predicates.h, and exactly parallel ones never cross.
+ */
+unsigned intersectBlock(const SegmentArray &segs, int s, int first, int count, float tol, float *t1, float *t2);
+
+// Edges e1 > e2 cross at parameter t1 along e1 and t2 along e2.
+struct Crossing {
+	int e1, e2;
+	float t1, t2;
+};
+
+// Finds every pair of segments that intersectBlock() reports, sorted by (e1, e2).
+void findCrossings(const SegmentArray &segs, float tol, ScratchVector<Crossing> &out);
+
+/*
+ * Same result as findCrossings(), but the sheet is cut into square tiles and
+ * each tile is searched on the shared thread pool. A pair is kept only by
+ * the tile holding the corner of its bounding box overlap, so nothing is
+ * reported twice and the result does not depend on the number of threads.
+ */
+void findCrossingsTiled(const SegmentArray &segs, float tol, int threads, ScratchVector<Crossing> &out);
@@ -0,0 +1,64 @@
+#pragma once
+#include <iostream>
+
+/*
+ * Leveled logging.
+ *
+ * Every level above PATTERN_LOG_MAX is removed by the preprocessor, so the
+ * per-element debug dumps cost nothing in release builds. Levels that are
+ * compiled in are additionally gated at runtime by setLogLevel(); only errors
+ * are printed until a program raises the level.
+ */
+
+#define PATTERN_LOG_NONE	0
+#define PATTERN_LOG_ERROR	1
+#define PATTERN_LOG_INFO	2	// one-line summaries
+#define PATTERN_LOG_DEBUG	3	// full element dumps
+
+#ifndef PATTERN_LOG_MAX
+#ifdef NDEBUG
+#define PATTERN_LOG_MAX PATTERN_LOG_INFO
+#else
+#define PATTERN_LOG_MAX PATTERN_LOG_DEBUG
+#endif
+#endif
+
+inline int &logLevelRef() {
+	static int level = PATTERN_LOG_ERROR;
+	return level;
+}
+
+inline int getLogLevel() {
+	return logLevelRef();
+}
+
+inline void setLogLevel(int level) {
+	logLevelRef() = level;
+}
+
+inline std::ostream &logStream() {
+	return std::cout;
+}
+
+#define PATTERN_LOG_IF(lvl, stmt) \
+	do { if (getLogLevel() >= (lvl)) { stmt; } } while (0)
+
+#if PATTERN_LOG_MAX >= PATTERN_LOG_ERROR
+#define LOG_ERROR(msg) PATTERN_LOG_IF(PATTERN_LOG_ERROR, logStream() << msg << '\n')
+#else
+#define LOG_ERROR(msg) do {} while (0)
+#endif
+
+#if PATTERN_LOG_MAX >= PATTERN_LOG_INFO
+#define LOG_INFO(msg) PATTERN_LOG_IF(PATTERN_LOG_INFO, logStream() << msg << '\n')
+#else
+#define LOG_INFO(msg) do {} while (0)
+#endif
+
+#if PATTERN_LOG_MAX >= PATTERN_LOG_DEBUG
+#define LOG_DEBUG(msg) PATTERN_LOG_IF(PATTERN_LOG_DEBUG, logStream() << msg << '\n')
+#define DEBUG_DUMP(call) PATTERN_LOG_IF(PATTERN_LOG_DEBUG, call)
+#else
+#define LOG_DEBUG(msg) do {} while (0)
+#define DEBUG_DUMP(call) do {} while (0)
+#endif
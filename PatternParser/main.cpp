@@ -0,0 +1,9 @@
+#include "pattern.h"
+#include "log.h"
+
+int main() {
+	setLogLevel(PATTERN_LOG_MAX);
+	Pattern p("../assets/Bases/boatBase.svg");
+	p.parse();
+	cin.get();
+}
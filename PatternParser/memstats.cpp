@@ -0,0 +1,76 @@
+#include "memstats.h"
+#include <atomic>
+
+struct AtomicCounters {
+	std::atomic<size_t> allocs;
+	std::atomic<size_t> bytes;
+	std::atomic<size_t> liveBytes;
+	std::atomic<size_t> peakBytes;
+};
+
+static AtomicCounters total;
+static AtomicCounters subsystems[SUBSYSTEM_COUNT];
+
+static thread_local SUBSYSTEM current = SubsystemOther;
+
+const char *subsystemName(SUBSYSTEM s) {
+	static const char *names[] = { "other", "xml", "geometry", "topology", "triangulation" };
+	return s < SUBSYSTEM_COUNT ? names[s] : "unknown";
+}
+
+static void add(AtomicCounters &c, size_t bytes) {
+	c.allocs.fetch_add(1, std::memory_order_relaxed);
+	c.bytes.fetch_add(bytes, std::memory_order_relaxed);
+	size_t live = c.liveBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+	size_t peak = c.peakBytes.load(std::memory_order_relaxed);
+	while (live > peak && !c.peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+}
+
+static MemCounters snapshot(const AtomicCounters &c) {
+	MemCounters m;
+	m.allocs = c.allocs.load(std::memory_order_relaxed);
+	m.bytes = c.bytes.load(std::memory_order_relaxed);
+	m.liveBytes = c.liveBytes.load(std::memory_order_relaxed);
+	m.peakBytes = c.peakBytes.load(std::memory_order_relaxed);
+	return m;
+}
+
+void memRecordAlloc(size_t bytes, SUBSYSTEM s) {
+	add(total, bytes);
+	add(subsystems[s], bytes);
+}
+
+void memRecordFree(size_t bytes, SUBSYSTEM s) {
+	total.liveBytes.fetch_sub(bytes, std::memory_order_relaxed);
+	subsystems[s].liveBytes.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+MemCounters memTotal() {
+	return snapshot(total);
+}
+
+MemCounters memSubsystem(SUBSYSTEM s) {
+	return snapshot(subsystems[s]);
+}
+
+void memResetPeak() {
+	total.peakBytes.store(total.liveBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+void memResetPeak(SUBSYSTEM s) {
+	AtomicCounters &c = subsystems[s];
+	c.peakBytes.store(c.liveBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+SUBSYSTEM currentSubsystem() {
+	return current;
+}
+
+SubsystemScope::SubsystemScope(SUBSYSTEM s)
+	:previous(current) {
+	current = s;
+}
+
+SubsystemScope::~SubsystemScope() {
+	current = previous;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstddef>
+
+/*
+ * Heap accounting per subsystem.
+ *
+ * The counters are only fed when the executable links allochooks.cpp, which
+ * replaces the global operator new/delete; without it everything here reads
+ * zero and costs nothing. The pipeline tags its allocations with a
+ * SubsystemScope, and the tag is kept with each block so frees are charged
+ * to the subsystem that allocated.
+ */
+
+enum SUBSYSTEM {
+	SubsystemOther, SubsystemXML, SubsystemGeometry, SubsystemTopology, SubsystemTriangulation, SUBSYSTEM_COUNT
+};
+
+const char *subsystemName(SUBSYSTEM s);
+
+struct MemCounters {
+	size_t allocs;
+	size_t bytes;		// bytes requested
+	size_t liveBytes;	// bytes currently allocated
+	size_t peakBytes;	// high-water mark of liveBytes since memResetPeak()
+};
+
+// Called by the allocation hooks.
+void memRecordAlloc(size_t bytes, SUBSYSTEM s);
+void memRecordFree(size_t bytes, SUBSYSTEM s);
+
+MemCounters memTotal();
+MemCounters memSubsystem(SUBSYSTEM s);
+
+// Restarts the high-water mark of the totals, or of one subsystem.
+void memResetPeak();
+void memResetPeak(SUBSYSTEM s);
+
+SUBSYSTEM currentSubsystem();
+
+// Tags the heap allocations of the current thread while it is alive.
+class SubsystemScope {
+private:
+	SUBSYSTEM previous;
+
+public:
+	SubsystemScope(SUBSYSTEM s);
+	~SubsystemScope();
+};
@@ -1,208 +1,562 @@
 #include "pattern.h"
 #include "geom.h"
+#include "log.h"
+#include "intersect.h"
+#include "predicates.h"
+#include "snap.h"
+#include "radixsort.h"
+#include "reorder.h"
+#include "faces.h"
+#include "docpool.h"
+#include <cassert>
+#include <set>
 
 /* Debug function */
 
-static void printVector3(Vector3 v) {
-	cout << "(" << v.x << "," << v.y << "," << v.z << ") ";
-}
-static void debugSort(vector<Vertice> vec) {
-	for (Vertice v : vec) {
-		cout << v.id << ": ";
-		printVector3(Vector3(v) - origin);
-		cout << ang2D(Vector3(v) - origin) << ", ";
-	}
-	cout << endl;
-}
-static void debugElementList(vector<XMLElement*> &vec) {
-	for (XMLElement* e : vec) {
-		XMLPrinter p;
-		e->Accept(&p);
-		cout << p.CStr();
-	}
-}
-
-static void debugEdgeList(vector<Edge> &vec) {
-	cout << endl << "Edge length: " << vec.size() << endl ;
-	string types[] = {
+#if PATTERN_LOG_MAX >= PATTERN_LOG_DEBUG
+static const char *typeNames[] = {
 	"Border", "Mountain", "Valley", "Facet","Cut", "Triangulation", "Hinge", "NONE"
-	};
-	int i = 0;
-	for (Edge e : vec) {
-		Vertice v1 = e.v1;
-		Vertice v2 = e.v2;
-		float angle = e.angle;
-		cout << "idx: " << i++ << "\t"
-			<< "type: " << types[e.type] << "\t"
-			<< "v1 :" << v1.x << "," << v1.y << "," << v1.z << ")\t"
-			<< "v2 :" << v2.x << "," << v2.y << "," << v2.z << ")\t"
-			<< "angle: " << angle << endl;
-	}
-}
+};
 
-static void debugVerticeList(vector<Vertice> &vec) {
-	cout << endl << "Vertice length: " << vec.size() << endl ;
-	for (Vertice v : vec) {
-		cout << "v (" << v.x << "," << v.y << "," << v.z << "), ";
+static void debugEdgeList(const VertexArray &vts, const EdgeArray &vec) {
+	ostream &out = logStream();
+	out << '\n' << "Edge length: " << vec.size() << '\n';
+	int n = vec.size();
+	for (int i = 0; i < n; i++) {
+		int v1 = vec.v0[i];
+		int v2 = vec.v1[i];
+		out << "idx: " << i << "\t"
+			<< "type: " << typeNames[vec.type[i]] << "\t"
+			<< "v1 :" << vts.x[v1] << "," << vts.y[v1] << "," << 0 << ")\t"
+			<< "v2 :" << vts.x[v2] << "," << vts.y[v2] << "," << 0 << ")\t"
+			<< "angle: " << vec.angle[i] << '\n';
 	}
-	cout << endl;
 }
 
-static void debugVerticeIDList(vector<Vertice> &vec) {
-	for (Vertice v : vec) 
-		cout << v.id << ", ";
-	cout << endl;
-}
-
-static void debugVerticeNeighbor(vector<vector<Vertice>> &vec) {
-	cout << endl<< "Neighbor length: " << vec.size() << endl ;
+static void debugVerticeList(const VertexArray &vec) {
+	ostream &out = logStream();
+	out << '\n' << "Vertice length: " << vec.size() << '\n';
 	int n = vec.size();
 	for (int i = 0; i < n; i++) {
-		vector<Vertice> neis = vec[i];
-		cout << "vertice " << i << ":\t";
-		debugVerticeIDList(neis);
+		out << "v (" << vec.x[i] << "," << vec.y[i] << "," << 0 << "), ";
 	}
+	out << '\n';
 }
 
-static void debugFaceList(vector<Face> &vec) {
-	cout << endl << "Face length: " << vec.size() << endl;
+static void debugVerticeNeighbor(const NeighborArray &vec) {
+	ostream &out = logStream();
+	out << '\n' << "Neighbor length: " << vec.size() << '\n';
 	int n = vec.size();
 	for (int i = 0; i < n; i++) {
-		Face f = vec[i];
-		cout << "Face " << i << ":\t";
-		debugVerticeIDList(f.vts);
+		out << "vertice " << i << ":\t";
+		for (const int *k = vec.begin(i); k != vec.end(i); k++)
+			out << *k << ", ";
+		out << '\n';
 	}
 }
 
-/* Helper function */
-static void SplitString(const std::string& s, std::vector<std::string>& v, const std::string& c)
-{
-	std::string::size_type pos1, pos2;
-	pos2 = s.find(c);
-	pos1 = 0;
-	while (std::string::npos != pos2)
-	{
-		v.push_back(s.substr(pos1, pos2 - pos1));
-
-		pos1 = pos2 + c.size();
-		pos2 = s.find(c, pos1);
+static void debugFaceList(const FaceArray &vec) {
+	ostream &out = logStream();
+	out << '\n' << "Face length: " << vec.size() << '\n';
+	int n = vec.size();
+	for (int i = 0; i < n; i++) {
+		out << "Face " << i << ":\t";
+		for (const int *k = vec.begin(i); k != vec.end(i); k++)
+			out << *k << ", ";
+		out << '\n';
 	}
-	if (pos1 != s.length())
-		v.push_back(s.substr(pos1));
 }
 
-static int str2int(string str) {
-	stringstream ss;
-	int ret;
-	ss << str;
-	ss >> ret;
-	return ret;
+static void debugHoleList(const FaceArray &vec) {
+	int n = vec.size();
+	for (int i = 0; i < n; i++) {
+		if (vec.kind[i] == FaceHole)
+			logStream() << "Hole " << i << " in face " << vec.parent[i] << '\n';
+	}
 }
 
-static string uv2string(int u, int v) {
-	stringstream ss;
-	string ret;
-	ss << u << "," << v;
-	ss >> ret;
-	return ret;
+static void debugTriangleList(const TriangleArray &vec) {
+	ostream &out = logStream();
+	out << '\n' << "Triangle length: " << vec.size() << '\n';
+	int n = vec.size();
+	for (int i = 0; i < n; i++)
+		out << "Triangle " << i << ":\t" << vec[i][0] << ", " << vec[i][1] << ", " << vec[i][2] << '\n';
 }
+#endif
 
+/* Helper function */
 static char easytolower(char in) {
 	if (in <= 'Z' && in >= 'A')
 		return in - ('Z' - 'z');
 	return in;
 }
 
-static bool compareVertice(Vertice v1, Vertice v2) {
-	if (v1.x != v2.x)
-		return v1.x < v2.x;
-	if (v1.y != v2.y)
-		return v1.y < v2.y;
-	return v1.z < v2.z;
-}
-
-static bool compareEdge(Edge e1, Edge e2) {
-	if (e1.v1 == e2.v1)
-		return compareVertice(e1.v2, e2.v2);
-	return compareVertice(e1.v1, e2.v1);
-}
-
-static bool compareNeighbors(Vertice &v1, Vertice &v2) {
-	return sortByAngle(Vector3(v1), Vector3(v2));
-}
-
-static void UniqueVertices(vector<Vertice> &vec) {
-	sort(vec.begin(), vec.end(), compareVertice);
-	vec.erase(unique(vec.begin(), vec.end()), vec.end());
+// Sorts the neighbours of every vertex by decreasing angle around it.
+template <class P>
+static void sortByAngle(const VertexArray &vts, NeighborArray &neighbors) {
+	int n = neighbors.size();
+	for (int i = 0; i < n; i++) {
+		AngleGreater<P> greater(Vector3T<P>(Vertice(vts.x[i], vts.y[i])));
+		sort(neighbors.begin(i), neighbors.end(i), [&vts, &greater](int a, int b) {
+			return greater(Vector3T<P>(Vertice(vts.x[a], vts.y[a])), Vector3T<P>(Vertice(vts.x[b], vts.y[b])));
+		});
+	}
 }
 
-static void collapseNearbyVertices(vector<Vertice> &vec) {
-	vector<int> tobeErase;
-	int n = vec.size();
+// Whether the quad's diagonal 1-3 is shorter than 0-2.
+template <class P>
+static bool secondDiagonalShorter(const VertexArray &vts, const int *quad) {
+	Vector3T<P> p[4] = {
+		Vertice(vts.x[quad[0]], vts.y[quad[0]]), Vertice(vts.x[quad[1]], vts.y[quad[1]]),
+		Vertice(vts.x[quad[2]], vts.y[quad[2]]), Vertice(vts.x[quad[3]], vts.y[quad[3]])
+	};
+	typename P::Scalar dist1 = (p[0] - p[2]).lengthSq();
+	typename P::Scalar dist2 = (p[1] - p[3]).lengthSq();
+	return dist2 < dist1;
+}
+
+// Sorts the vertices by (x, y), merges exact duplicates and remaps the edges.
+static void UniqueVertices(VertexArray &vts, EdgeArray &edges) {
+	int n = vts.size();
+	const float *x = vts.x.data();
+	const float *y = vts.y.data();
+	ScratchVector<unsigned long long> keys(n);
+	ScratchVector<int> order(n);
 	for (int i = 0; i < n; i++) {
-		Vector3 v0(vec[i]);
-		Vector3 v1(vec[(i - 1 + n) % n]);
-		if (distance(v0, v1) < VERT_TOL)
-			tobeErase.push_back(i);
+		keys[i] = (unsigned long long)floatKey(x[i]) << 32 | floatKey(y[i]);
+		order[i] = i;
+	}
+	radixSort(keys, order);
+
+	ScratchVertexArray sorted;
+	sorted.reserve(n);
+	ScratchVector<int> remap(n);
+	for (int k = 0; k < n; k++) {
+		int i = order[k];
+		if (k == 0 || keys[k] != keys[k - 1])
+			sorted.add(x[i], y[i]);
+		remap[i] = sorted.size() - 1;
 	}
-	n = tobeErase.size();
-	vector<Vertice>::iterator base = vec.begin();
+	int m = edges.size();
+	for (int i = 0; i < m; i++) {
+		edges.v0[i] = remap[edges.v0[i]];
+		edges.v1[i] = remap[edges.v1[i]];
+	}
+	vts.assign(sorted);
+}
+
+// Rank of each TYPE when one edge is drawn with several, 0 wins. Edge
+// dedupe packs both vertex ids and this rank into one 64-bit key, so vertex
+// ids must stay below 2^EDGE_ID_BITS (about 268 million vertices).
+const int EDGE_ID_BITS = 28;
+static const unsigned char typePriority[] = {
+	1,	// Border
+	2,	// Mountain
+	3,	// Valley
+	5,	// Facet
+	0,	// Cut
+	6,	// Triangulation
+	4,	// Hinge
+	7	// NONE
+};
+
+/*
+ * Sorts the edges by (min vertex, max vertex) and keeps one edge per
+ * vertex pair, whichever direction it was drawn in. When the duplicates
+ * disagree on the type, the highest priority one is kept. The key packs
+ * EDGE_ID_BITS per vertex id and the priority.
+ */
+static void UniqueEdges(EdgeArray &edges) {
+	int n = edges.size();
+	ScratchVector<unsigned long long> keys(n);
+	ScratchVector<int> order(n);
 	for (int i = 0; i < n; i++) {
-		vec.erase(base + tobeErase[i] - i);
+		unsigned long long a = min(edges.v0[i], edges.v1[i]);
+		unsigned long long b = max(edges.v0[i], edges.v1[i]);
+		assert(b < (1ull << EDGE_ID_BITS) && "vertex id does not fit the edge key");
+		keys[i] = a << (EDGE_ID_BITS + 8) | b << 8 | typePriority[edges.type[i]];
+		order[i] = i;
+	}
+	radixSort(keys, order);
+
+	ScratchEdgeArray sorted;
+	sorted.reserve(n);
+	for (int k = 0; k < n; k++) {
+		unsigned long long key = keys[k];
+		if (k > 0 && key >> 8 == keys[k - 1] >> 8)
+			continue;
+		int i = order[k];
+		sorted.add((int)(key >> (EDGE_ID_BITS + 8)), (int)(key >> 8 & ((1u << EDGE_ID_BITS) - 1)), edges.angle[i], edges.type[i]);
+	}
+	edges.assign(sorted);
+}
+
+// Makes old vertex order[k] vertex k and re-sorts the edges to match.
+static void renumberVertices(VertexArray &vts, EdgeArray &edges, const ScratchVector<int> &order) {
+	int n = vts.size();
+	ScratchVertexArray renumbered;
+	renumbered.reserve(n);
+	ScratchVector<int> remap(n);
+	for (int k = 0; k < n; k++)
+		remap[order[k]] = renumbered.add(vts.x[order[k]], vts.y[order[k]]);
+	int m = edges.size();
+	for (int i = 0; i < m; i++) {
+		edges.v0[i] = remap[edges.v0[i]];
+		edges.v1[i] = remap[edges.v1[i]];
 	}
+	vts.assign(renumbered);
+	UniqueEdges(edges);
 }
 
-static void UniqueEdges(vector<Edge> &vec) {
-	sort(vec.begin(), vec.end(), compareEdge);
-	vec.erase(unique(vec.begin(), vec.end()), vec.end());
+static int findRoot(ScratchVector<int> &parent, int v) {
+	while (parent[v] != v) {
+		parent[v] = parent[parent[v]];
+		v = parent[v];
+	}
+	return v;
 }
 
-// http://paulbourke.net/geometry/pointlineplane/
-static void line_intersect(Vector2 &v1, Vector2 &v2, Vector2 &v3, Vector2 &v4, Vector2 &intersection, float &t1, float &t2) {
-	float x1 = v1.x;
-	float y1 = v1.y;
-	float x2 = v2.x;
-	float y2 = v2.y;
-	float x3 = v3.x;
-	float y3 = v3.y;
-	float x4 = v4.x;
-	float y4 = v4.y;
+// A split point along an edge.
+struct Hit {
+	float t;
+	int vertex;
+};
 
-	float denom = (y4 - y3)*(x2 - x1) - (x4 - x3)*(y2 - y1);
-	if (denom == 0) {
-		return;
+static bool operator<(const Hit &a, const Hit &b) {
+	return a.t != b.t ? a.t < b.t : a.vertex < b.vertex;
+}
+
+/*
+ * Splits the edges at every crossing in one pass. The split points are
+ * bucketed by edge with a counting sort and ordered along each edge; points
+ * closer than VERT_TOL along an edge are welded into the vertex with the
+ * lowest id, so lines through a common point meet in one vertex. The pieces
+ * are written to a fresh array in the order of the edges they came from.
+ */
+static void splitAtCrossings(VertexArray &vts, EdgeArray &edges, const SegmentArray &segs, const ScratchVector<Crossing> &crossings) {
+	int ne = edges.size();
+	int nc = crossings.size();
+	ScratchVector<int> points(nc);
+	ScratchVector<int> offsets(ne + 1, 0);
+	for (int i = 0; i < nc; i++) {
+		const Crossing &c = crossings[i];
+		float length1 = segs.length[c.e1];
+		float length2 = segs.length[c.e2];
+		float d1 = c.t1 * length1;
+		float d2 = c.t2 * length2;
+		bool seg1Int = d1 > VERT_TOL && d1 < length1 - VERT_TOL;
+		bool seg2Int = d2 > VERT_TOL && d2 < length2 - VERT_TOL;
+
+		if (seg1Int && seg2Int)
+			points[i] = vts.add(segs.x0[c.e1] + c.t1 * (segs.x1[c.e1] - segs.x0[c.e1]),
+				segs.y0[c.e1] + c.t1 * (segs.y1[c.e1] - segs.y0[c.e1]));
+		else if (seg1Int)
+			points[i] = d2 <= VERT_TOL ? edges.v0[c.e2] : edges.v1[c.e2];
+		else
+			points[i] = d1 <= VERT_TOL ? edges.v0[c.e1] : edges.v1[c.e1];
+		if (seg1Int) offsets[c.e1 + 1]++;
+		if (seg2Int) offsets[c.e2 + 1]++;
+	}
+	for (int e = 0; e < ne; e++)
+		offsets[e + 1] += offsets[e];
+
+	int nh = offsets[ne];
+	ScratchVector<Hit> hits(nh);
+	ScratchVector<int> fill(offsets.begin(), offsets.end() - 1);
+	for (int i = 0; i < nc; i++) {
+		const Crossing &c = crossings[i];
+		float d1 = c.t1 * segs.length[c.e1];
+		float d2 = c.t2 * segs.length[c.e2];
+		if (d1 > VERT_TOL && d1 < segs.length[c.e1] - VERT_TOL) {
+			Hit h = { c.t1, points[i] };
+			hits[fill[c.e1]++] = h;
+		}
+		if (d2 > VERT_TOL && d2 < segs.length[c.e2] - VERT_TOL) {
+			Hit h = { c.t2, points[i] };
+			hits[fill[c.e2]++] = h;
+		}
 	}
-	t1 = ((x4 - x3)*(y1 - y3) - (y4 - y3)*(x1 - x3)) / denom;
-	t2 = ((x2 - x1)*(y1 - y3) - (y2 - y1)*(x1 - x3)) / denom;
-
-	intersection.x = x1 + t1 * (x2 - x1);
-	intersection.y = y1 + t1 * (y2 - y1);
-	return;
-}
 
-static float getDistFromEnd(float t, float length, float tol) {
-	float  dist = t * length;
-	if (dist < -tol) return NULL_DIST;
-	if (dist > length + tol) return NULL_DIST;
-	return dist;
-}
+	int nv = vts.size();
+	ScratchVector<int> parent(nv);
+	for (int v = 0; v < nv; v++)
+		parent[v] = v;
+	for (int e = 0; e < ne; e++) {
+		Hit *first = hits.data() + offsets[e], *last = hits.data() + offsets[e + 1];
+		// a handful of hits per edge: insertion sort
+		for (Hit *h = first + 1; h < last; h++) {
+			Hit x = *h;
+			Hit *p = h;
+			for (; p > first && x < p[-1]; p--)
+				*p = p[-1];
+			*p = x;
+		}
+		for (Hit *h = first + 1; h < last; h++) {
+			if ((h->t - h[-1].t) * segs.length[e] > VERT_TOL)
+				continue;
+			int ra = findRoot(parent, h[-1].vertex), rb = findRoot(parent, h->vertex);
+			if (ra < rb) parent[rb] = ra;
+			else parent[ra] = rb;
+		}
+	}
 
-static int getpolygonOrientation(vector<Vertice> vec) {
-	vector<Vector3> tmp;
-	for (Vertice v : vec) {
-		tmp.push_back(Vector3(v));
+	// drop the welded-away vertices
+	ScratchVector<int> remap(nv);
+	ScratchVertexArray kept;
+	kept.reserve(nv);
+	for (int v = 0; v < nv; v++) {
+		if (findRoot(parent, v) == v)
+			remap[v] = kept.add(vts.x[v], vts.y[v]);
+	}
+	for (int v = 0; v < nv; v++)
+		remap[v] = remap[findRoot(parent, v)];
+
+	// edges run from the lower vertex id, so pieces of lines drawn in opposite
+	// directions come out identical and dedupe can drop them
+	ScratchEdgeArray out;
+	out.reserve(ne + nh);
+	for (int e = 0; e < ne; e++) {
+		int prev = remap[edges.v0[e]], last = remap[edges.v1[e]];
+		for (int k = offsets[e]; k <= offsets[e + 1]; k++) {
+			int v = k == offsets[e + 1] ? last : remap[hits[k].vertex];
+			if (v != prev)
+				out.add(min(prev, v), max(prev, v), edges.angle[e], edges.type[e]);
+			prev = v;
+		}
 	}
-	return polygonOrientation(tmp);
+	vts.assign(kept);
+	edges.assign(out);
 }
 
+// An edge's supporting line: unit direction with a pseudo-angle in [0, 2)
+// standing in for its angle, and the signed offset from the origin.
+struct LineKey {
+	double angle, offset, dx, dy;
+	int edge;
+};
 
+/*
+ * Merges collinear edges that overlap. The crossing search skips parallel
+ * pairs, so a long line drawn over shorter ones would keep them all; this
+ * runs on the edges as loaded, before that search. Edges are grouped by line
+ * (direction within COLLINEAR_ANGLE, then offset and every endpoint within
+ * COLLINEAR_TOL of the group's first edge); the endpoints of a group are
+ * sorted along the line, those closer than VERT_TOL welded like the split
+ * points of splitAtCrossings(), and each piece between consecutive
+ * endpoints is emitted once, typed by the highest priority edge covering
+ * it. Groups whose edges only touch end to end keep their edges.
+ */
+static void mergeCollinear(VertexArray &vts, EdgeArray &edges) {
+	int n = edges.size();
+	const float *x = vts.x.data();
+	const float *y = vts.y.data();
+	ScratchVector<LineKey> keyed(n);
+	for (int e = 0; e < n; e++) {
+		int a = edges.v0[e], b = edges.v1[e];
+		double dx = (double)x[b] - x[a], dy = (double)y[b] - y[a];
+		double length = sqrt(dx * dx + dy * dy);
+		if (length > 0) {
+			dx /= length;
+			dy /= length;
+		}
+		if (dy < 0 || (dy == 0 && dx < 0)) {
+			dx = -dx;
+			dy = -dy;
+		}
+		double angle = length > 0 ? 1 - dx / (fabs(dx) + dy) : 0;
+		if (angle > 2 - COLLINEAR_ANGLE) {	// near horizontal lines all start near 0
+			angle -= 2;
+			dx = -dx;
+			dy = -dy;
+		}
+		LineKey key = { angle, y[a] * dx - x[a] * dy, dx, dy, e };
+		keyed[e] = key;
+	}
+	// by angle, then by offset within each run of nearly equal angles
+	ScratchVector<unsigned long long> keys(n);
+	ScratchVector<int> order(n);
+	for (int e = 0; e < n; e++) {
+		keys[e] = floatKey((float)keyed[e].angle);
+		order[e] = e;
+	}
+	radixSort(keys, order);
+	for (int k = 0, run = 0, first = 0; k < n; k++) {
+		if (keyed[order[k]].angle - keyed[order[first]].angle >= COLLINEAR_ANGLE) {
+			first = k;
+			run++;
+		}
+		keys[k] = (unsigned long long)run << 32 | floatKey((float)keyed[order[k]].offset);
+	}
+	radixSort(keys, order);
+	ScratchVector<LineKey> lines(n);
+	for (int k = 0; k < n; k++)
+		lines[k] = keyed[order[k]];
+
+	int nv = vts.size();
+	ScratchVector<int> parent(nv);
+	for (int v = 0; v < nv; v++)
+		parent[v] = v;
+	bool welded = false;
+	ScratchVector<char> replaced(n, 0);
+	ScratchEdgeArray merged;
+	ScratchVector<pair<double, int>> points, ends;	// (distance along the line, vertex)
+	ScratchVector<int> members, kept, alias, cover;
+	struct Span { int from, to, rank, edge; };
+	ScratchVector<Span> spans;
+	set<pair<int, int>, less<pair<int, int>>, ScratchAllocator<pair<int, int>>> active;	// (rank, span) covering the current piece
+	for (int first = 0; first < n;) {
+		int end = first + 1;
+		while (end < n && keys[end] >> 32 == keys[first] >> 32)
+			end++;
+		for (int g = first; g < end;) {
+			int h = g + 1;
+			while (h < end && lines[h].offset - lines[g].offset < COLLINEAR_TOL)
+				h++;
+			if (h - g < 2) {
+				g = h;
+				continue;
+			}
 
+			int ref = lines[g].edge;
+			double ox = x[edges.v0[ref]], oy = y[edges.v0[ref]];
+			double dx = lines[g].dx, dy = lines[g].dy;
+			members.clear();
+			points.clear();
+			for (int k = g; k < h; k++) {
+				int e = lines[k].edge;
+				int a = edges.v0[e], b = edges.v1[e];
+				if (fabs((x[a] - ox) * dy - (y[a] - oy) * dx) > COLLINEAR_TOL ||
+					fabs((x[b] - ox) * dy - (y[b] - oy) * dx) > COLLINEAR_TOL)
+					continue;
+				members.push_back(e);
+				points.push_back(make_pair((x[a] - ox) * dx + (y[a] - oy) * dy, a));
+				points.push_back(make_pair((x[b] - ox) * dx + (y[b] - oy) * dy, b));
+			}
+			g = h;
+			if (members.size() < 2)
+				continue;
+			// each member's endpoints are at points[2 * m] and points[2 * m + 1]
+			ends = points;
+			sort(points.begin(), points.end());
+			points.erase(unique(points.begin(), points.end()), points.end());
+
+			// endpoints closer than VERT_TOL along the line are welded
+			kept.clear();
+			alias.resize(points.size());
+			for (size_t k = 0; k < points.size(); k++) {
+				if (kept.empty() || points[k].first - points[kept.back()].first >= VERT_TOL)
+					kept.push_back(k);
+				else {
+					int ra = findRoot(parent, points[kept.back()].second), rb = findRoot(parent, points[k].second);
+					if (ra < rb) parent[rb] = ra;
+					else parent[ra] = rb;
+					welded = true;
+				}
+				alias[k] = kept.size() - 1;
+			}
 
+			// a piece covered by more than one edge is an overlap
+			spans.clear();
+			cover.assign(kept.size() + 1, 0);
+			for (size_t m = 0; m < members.size(); m++) {
+				int a = alias[lower_bound(points.begin(), points.end(), ends[2 * m]) - points.begin()];
+				int b = alias[lower_bound(points.begin(), points.end(), ends[2 * m + 1]) - points.begin()];
+				Span s = { min(a, b), max(a, b), typePriority[edges.type[members[m]]], members[m] };
+				spans.push_back(s);
+				cover[s.from]++;
+				cover[s.to]--;
+			}
+			bool overlap = false;
+			int depth = 0;
+			for (size_t k = 0; k < kept.size() && !overlap; k++) {
+				depth += cover[k];
+				overlap = depth > 1;
+			}
+			if (!overlap)
+				continue;
+
+			// sweep the pieces; spans that ended are dropped once they reach the front
+			sort(spans.begin(), spans.end(), [](const Span &a, const Span &b) {
+				return a.from != b.from ? a.from < b.from : a.edge < b.edge;
+			});
+			active.clear();
+			size_t next = 0;
+			for (int k = 0; k + 1 < (int)kept.size(); k++) {
+				for (; next < spans.size() && spans[next].from == k; next++)
+					active.insert(make_pair(spans[next].rank, (int)next));
+				while (!active.empty() && spans[active.begin()->second].to <= k)
+					active.erase(active.begin());
+				if (active.empty())
+					continue;
+				int e = spans[active.begin()->second].edge;
+				int a = points[kept[k]].second, b = points[kept[k + 1]].second;
+				merged.add(min(a, b), max(a, b), edges.angle[e], edges.type[e]);
+			}
+			for (int e : members)
+				replaced[e] = 1;
+		}
+		first = end;
+	}
+	if (merged.size() == 0 && !welded)
+		return;
 
+	ScratchVector<int> remap(nv);
+	ScratchVertexArray keptVts;
+	keptVts.reserve(nv);
+	for (int v = 0; v < nv; v++) {
+		if (findRoot(parent, v) == v)
+			remap[v] = keptVts.add(vts.x[v], vts.y[v]);
+	}
+	for (int v = 0; v < nv; v++)
+		remap[v] = remap[findRoot(parent, v)];
+
+	ScratchEdgeArray out;
+	out.reserve(n + merged.size());
+	for (int e = 0; e < n; e++) {
+		int a = remap[edges.v0[e]], b = remap[edges.v1[e]];
+		if (!replaced[e] && a != b)
+			out.add(min(a, b), max(a, b), edges.angle[e], edges.type[e]);
+	}
+	for (int e = 0; e < (int)merged.size(); e++) {
+		int a = remap[merged.v0[e]], b = remap[merged.v1[e]];
+		if (a != b)
+			out.add(min(a, b), max(a, b), merged.angle[e], merged.type[e]);
+	}
+	vts.assign(keptVts);
+	edges.assign(out);
+}
+
+// Drops dangling creases (a, b, a) from a closed cycle, leaving the polygon around them.
+static void pruneSpurs(ScratchVector<int> &cycle) {
+	size_t k = 0;
+	for (int v : cycle) {
+		if (k >= 2 && cycle[k - 2] == v) {
+			k--;
+			continue;
+		}
+		cycle[k++] = v;
+	}
+	// spurs through the start of the cycle
+	size_t head = 0;
+	while (k - head >= 3) {
+		if (cycle[k - 1] == cycle[head + 1]) {
+			head++;
+			k--;
+		}
+		else if (cycle[k - 2] == cycle[head])
+			k -= 2;
+		else
+			break;
+	}
+	if (k - head < 3)
+		k = head;
+	cycle.erase(cycle.begin() + k, cycle.end());
+	cycle.erase(cycle.begin(), cycle.begin() + head);
+}
 
 /* Class Methods*/
 
-void Pattern::getElementList(vector<XMLElement*> &vec, XMLElement *root, string name) {
+void Pattern::getElementList(ScratchVector<XMLElement*> &vec, XMLElement *root, string name) {
 	XMLElement *tmp;
 	if (root) {
 		tmp = root->FirstChildElement(name.c_str());
@@ -217,8 +571,8 @@ const string Pattern::getStroke(XMLElement* e) {
 	const char* s = e->Attribute("stroke");
 	if (!s) {
 		XMLElement *t = e->FirstChildElement("style");
-		if (!t || (s = t->Attribute("stroke"))) 
-			return NULL;
+		if (!t || !(s = t->Attribute("stroke")))
+			return "";
 	}
 	string tmp(s);
 	transform(tmp.begin(), tmp.end(), tmp.begin(), ::easytolower);
@@ -253,7 +607,8 @@ TYPE Pattern::typeForStroke(const string stroke) {
 	return TYPE::NONE;
 }
 
-void Pattern::parseLine(vector<XMLElement*> &vec) {
+void Pattern::parseLine(ScratchVector<XMLElement*> &vec) {
+	SubsystemScope scope(SubsystemGeometry);
 	for (XMLElement *e : vec) {
 		float x1, y1, x2, y2;
 		x1 = e->FloatAttribute("x1");
@@ -261,26 +616,24 @@ void Pattern::parseLine(vector<XMLElement*> &vec) {
 		x2 = e->FloatAttribute("x2");
 		y2 = e->FloatAttribute("y2");
 
-		Vertice v1(x1, y1);
-		Vertice v2(x2, y2);
-
-		verticesRaw.push_back(v1);
-		verticesRaw.push_back(v2);
+		int v1 = vertices.add(x1, y1);
+		int v2 = vertices.add(x2, y2);
 
 		TYPE type = typeForStroke(getStroke(e));
 		switch (type) {
 		case Border:
+		case Facet:
 		case Cut:
 		case Triangulation:
 		case Hinge:
-			edgesRaw.push_back(Edge(v1, v2, type));
+			edges.add(v1, v2, 0, type);
 			break;
 		case Mountain: {
-			edgesRaw.push_back(Edge(v1,v2,-getOpacityAngle(e),type));
+			edges.add(v1, v2, -getOpacityAngle(e), type);
 			break;
-		}			
+		}
 		case Valley: {
-			edgesRaw.push_back(Edge(v1, v2, getOpacityAngle(e), type));
+			edges.add(v1, v2, getOpacityAngle(e), type);
 			break;
 		}
 		case NONE:
@@ -289,7 +642,8 @@ void Pattern::parseLine(vector<XMLElement*> &vec) {
 	}
 }
 
-void Pattern::parseRect(vector<XMLElement*> &vec) {
+void Pattern::parseRect(ScratchVector<XMLElement*> &vec) {
+	SubsystemScope scope(SubsystemGeometry);
 	for (XMLElement *e : vec) {
 		float x, y, w, h;
 		x = e->FloatAttribute("x");
@@ -297,245 +651,134 @@ void Pattern::parseRect(vector<XMLElement*> &vec) {
 		w = e->FloatAttribute("width");
 		h = e->FloatAttribute("height");
 
-		Vertice v1(x, y);
-		Vertice v2(x + w, y);
-		Vertice v3(x, y + h);
-		Vertice v4(x + w, y + h);
+		int v1 = vertices.add(x, y);
+		int v2 = vertices.add(x + w, y);
+		int v3 = vertices.add(x, y + h);
+		int v4 = vertices.add(x + w, y + h);
 
 		TYPE type = TYPE::Border;
-		Edge e1(v1, v2, type);
-		Edge e2(v1, v3, type);
-		Edge e3(v2, v4, type);
-		Edge e4(v3, v4, type);
-
-		verticesRaw.push_back(v1);
-		verticesRaw.push_back(v2);
-		verticesRaw.push_back(v3);
-		verticesRaw.push_back(v4);
-
-		edgesRaw.push_back(e1);
-		edgesRaw.push_back(e2);
-		edgesRaw.push_back(e3);
-		edgesRaw.push_back(e4);
+		edges.add(v1, v2, 0, type);
+		edges.add(v1, v3, 0, type);
+		edges.add(v2, v4, 0, type);
+		edges.add(v3, v4, 0, type);
 	}
 }
 
 void Pattern::findIntersections() {
-	int N = edgesRaw.size();
-	for (int i = N - 1; i >= 0; i--) {
-		for (int j = i - 1; j >= 0; j--) {
-			Edge e1 = edgesRaw[i];
-			Edge e2 = edgesRaw[j];
-			Vector2 v1 = Vector2(e1.v1);
-			Vector2 v2 = Vector2(e1.v2);
-			Vector2 v3 = Vector2(e2.v1);
-			Vector2 v4 = Vector2(e2.v2);
-
-			Vector2 intersection;
-			Vector2 empty;
-			float t1, t2;
-			line_intersect(v1, v2, v3, v4, intersection, t1, t2);
-
-			if (intersection == empty) continue;
-
-			float length1 = v1.distance(v2);
-			float length2 = v3.distance(v4);
-
-			float d1 = getDistFromEnd(t1, length1, VERT_TOL);
-			float d2 = getDistFromEnd(t2, length2, VERT_TOL);
-
-			if (d1 == NULL_DIST || d2 == NULL_DIST) continue;	//no crossing
-
-			bool seg1Int = d1 > VERT_TOL && d1 < length1 - VERT_TOL;
-			bool seg2Int = d2 > VERT_TOL && d2 < length2 - VERT_TOL;
-
-			if (!seg1Int && !seg2Int) continue;	//intersects at endpoints only
-
-			Vertice *point = NULL;
-			if (seg1Int && seg2Int) {
-				point = &Vertice(intersection.x, intersection.y);
-				verticesRaw.push_back(*point);
-			}
-			else if (seg1Int) {
-				if (d2 <= VERT_TOL) point = &Vertice(v3.x, v3.y);
-				else point = &Vertice(v4.x, v4.y);
-			}
-			else {
-				if (d1 <= VERT_TOL) point = &Vertice(v1.x, v1.y);
-				else point = &Vertice(v2.x, v2.y);
-			}
-
-			if (seg1Int) {
-				edgesRaw.erase(edgesRaw.begin() + i);
-				edgesRaw.insert(edgesRaw.begin() + i, Edge(*point, e1.v1, e1.angle, e1.type));
-				edgesRaw.insert(edgesRaw.begin() + i + 1, Edge(*point, e1.v2, e1.angle, e1.type));
-				i++;
-			}
-			if (seg2Int) {
-				edgesRaw.erase(edgesRaw.begin() + j);
-				edgesRaw.insert(edgesRaw.begin() + j, Edge(*point, e2.v1, e2.angle, e2.type));
-				edgesRaw.insert(edgesRaw.begin() + j + 1, Edge(*point, e2.v2, e2.angle, e2.type));
-				i++;
-				j++;
-			}
-		}
+	if (snapStep > 0) {
+		splitSnapped(vertices, edges, snapStep, typePriority);
+		return;
+	}
+	mergeCollinear(vertices, edges);
+	SegmentArray &segs = segments;
+	buildSegments(vertices, edges, segs);
+	ScratchVector<Crossing> crossings;
+	if (options.intersect == IntersectTiled)
+		findCrossingsTiled(segs, VERT_TOL, options.threads, crossings);
+	else
+		findCrossings(segs, VERT_TOL, crossings);
+	splitAtCrossings(vertices, edges, segs, crossings);
+}
+
+void Pattern::reorderVertices() {
+	ScratchVector<int> order;
+	switch (options.vertexOrder) {
+	case OrderMorton: mortonOrder(vertices, order); break;
+	case OrderRCM: rcmOrder(vertices, edges, order); break;
+	default: return;
 	}
+	stats.bandwidth[0] = bandwidth(edges);
+	renumberVertices(vertices, edges, order);
+	stats.bandwidth[1] = bandwidth(edges);
+	LOG_INFO(SVGfilename << ": vertex bandwidth " << stats.bandwidth[0] << " -> " << stats.bandwidth[1]);
 }
 
 void Pattern::findVerticeNeighbors() {
-	int n = verticesRaw.size();
-	for (int i = 0; i < n; i++) {
-		verticesRaw[i].id = i;
-		verticeNeighbors.push_back(vector<Vertice>());
-	}
-	
-	vector<Vertice>::iterator base = verticesRaw.begin();
-	for (Edge e : edgesRaw) {
-		vector<Vertice>::iterator it1, it2;
-		it1 = find(verticesRaw.begin(), verticesRaw.end(), e.v1);
-		it2 = find(verticesRaw.begin(), verticesRaw.end(), e.v2);
-		int idx1,idx2;
-		idx1 = it1 - base;
-		idx2 = it2 - base;
-		verticeNeighbors[idx1].push_back(verticesRaw[idx2]);
-		verticeNeighbors[idx2].push_back(verticesRaw[idx1]);
-	}
-	
+	verticeNeighbors.build(vertices.size(), edges);
 }
 
 
 void Pattern::sortVerticeNeighbors() {
-	int n = verticeNeighbors.size();
-	for (int i = 0; i < n; i++) {
-		origin = Vector3(verticesRaw[i]);
-		vector<Vertice> list = verticeNeighbors[i];
-		sort(list.begin(), list.end(), compareNeighbors);
-		verticeNeighbors[i] = list;
-	}
-}
-
-void Pattern::findFaces(){
-	Vertice u, v, w;
-	int len = verticeNeighbors.size();
-	map<string, Vertice> next;
-	vector<string> keys;
-	for (int i = 0; i < len;i++) {
-		vector<Vertice> neighbors = verticeNeighbors[i];
-		v = verticesRaw[i];
-		int n = neighbors.size();
-		for (int j = 0; j < n;j++) {
-			u = neighbors[j];
-			string uv = uv2string(u.id, v.id);
-			keys.push_back(uv);
-			next[uv] = neighbors[(j-1+n)%n];
+	double step = snapStep;
+	if (step > 0) {
+		int n = verticeNeighbors.size();
+		for (int i = 0; i < n; i++) {
+			GridPoint o = toGrid(vertices.x[i], vertices.y[i], step);
+			const VertexArray &vts = vertices;
+			sort(verticeNeighbors.begin(i), verticeNeighbors.end(i), [&vts, o, step](int a, int b) {
+				return angleGreater(o, toGrid(vts.x[a], vts.y[a], step), toGrid(vts.x[b], vts.y[b], step));
+			});
 		}
+		return;
 	}
-	
-	int len2 = keys.size();
-	Vertice zero(0, 0, 0);
-	for (int i = 0; i < len2;i++) {
-		string uv = keys[i];
-		w = next[uv];
-		if (w == zero) {
-			continue;
-		}
-		next[uv] = zero;
-		vector<string> vec;
-		SplitString(uv, vec, ",");
-		u = verticesRaw[str2int(vec[0])];
-		v = verticesRaw[str2int(vec[1])];
-
-		vector<Vertice> face;
-		face.push_back(u);
-		face.push_back(v);
-
-		while (!(w == face[0])) {
-			if (w == zero) {
-				cout << "Confusion with face \n";
-				break;
-			}
-			face.push_back(w);
-			u = v;
-			v = w;
-			uv = uv2string(u.id, v.id);
-			w = next[uv];
-			next[uv] = zero;
-		}
-
-		uv = uv2string(face[face.size()-1].id, face[0].id);
-		next[uv] = zero;
-
-		int ori = getpolygonOrientation(face);
-		if (!(w == zero) && ori < 0) {	// ֻҪʱ
-			facesRaw.push_back(Face(face));
-		}
+	switch (options.anglePrecision) {
+	case PrecisionDouble: sortByAngle<DoublePolicy>(vertices, verticeNeighbors); break;
+	default: sortByAngle<FloatPolicy>(vertices, verticeNeighbors); break;
 	}
-};
+}
 
-void Pattern::triangulatePolys() {
-	int n = facesRaw.size();
-	vector<Face> triangulatedFaces;
-	for (int i = 0; i < n; i++) {
+void Pattern::findFaces() {
+	if (options.faces == FacesParallel)
+		extractFacesParallel(vertices, verticeNeighbors, options.threads, cycles);
+	else
+		extractFaces(vertices, verticeNeighbors, cycles);
+}
 
-		Face face = facesRaw[i];
+void Pattern::triangulatePolys() {
+	int n = cycles.size();
+	triangles.clear();
+	ScratchVector<int> polygon;
+	for (int f = 0; f < n; f++) {
+		if (cycles.kind[f] != FaceInterior)	// ֻҪʱ
+			continue;
+		polygon.assign(cycles.begin(f), cycles.end(f));
+		pruneSpurs(polygon);
+		const int *p = polygon.data();
 
-		int facelen = face.vts.size();
+		int facelen = polygon.size();
 		if (facelen == 3) {
-			triangulatedFaces.push_back(face);
+			triangles.add(p[0], p[1], p[2]);
 			continue;
 		}
 
 		//check for quad and solve manually
 		if (facelen == 4) {
-			vector<Vertice> faceVts = face.vts;
-			vector<Vertice> faceVts1 = face.vts;
-
-			Vector3 faceV1 = Vector3(faceVts[0]);
-			Vector3 faceV2 = Vector3(faceVts[1]);
-			Vector3 faceV3 = Vector3(faceVts[2]);
-			Vector3 faceV4 = Vector3(faceVts[3]);
-
-			float dist1 = (faceV1 - faceV3).lengthSq();
-			float dist2 = (faceV2 - faceV4).lengthSq();
-
-			if (dist2 < dist1) {
-				edgesRaw.push_back(Edge(faceVts[1], faceVts[3], 0, TYPE::Facet));
-				
-				faceVts.erase(faceVts.begin() + 2);
-				triangulatedFaces.push_back(Face(faceVts));
-					
-				faceVts1.erase(faceVts1.begin() + 0);
-				triangulatedFaces.push_back(Face(faceVts1));
+			bool shorter;
+			switch (options.anglePrecision) {
+			case PrecisionDouble: shorter = secondDiagonalShorter<DoublePolicy>(vertices, p); break;
+			default: shorter = secondDiagonalShorter<FloatPolicy>(vertices, p); break;
 			}
-			else {
-				edgesRaw.push_back(Edge(faceVts[0], faceVts[2], 0, TYPE::Facet));
 
-				faceVts.erase(faceVts.begin() + 3);
-				triangulatedFaces.push_back(Face(faceVts));
-
-				faceVts1.erase(faceVts1.begin() + 1);
-				triangulatedFaces.push_back(Face(faceVts1));
+			if (shorter) {
+				edges.add(p[1], p[3], 0, TYPE::Facet);
+				triangles.add(p[0], p[1], p[3]);
+				triangles.add(p[1], p[2], p[3]);
+			}
+			else {
+				edges.add(p[0], p[2], 0, TYPE::Facet);
+				triangles.add(p[0], p[1], p[2]);
+				triangles.add(p[0], p[2], p[3]);
 			}
 			continue;
 		}
 
 		// todo: 4ϵǻ
 	}
-	facesRaw = triangulatedFaces;
 }
 
 void Pattern::loadSVG() {
-	XMLDocument svg;
-	svg.LoadFile(SVGfilename.c_str());
+	StageTimer timer(stats, StageLoad);
+	SubsystemScope scope(SubsystemXML);
+	XMLDocument &svg = DocumentPool::local().load(SVGfilename.c_str());
 
 	if (svg.ErrorID() != 0) {
-		cout << "Load svg: " << SVGfilename << " ERROR!" << endl;
+		LOG_ERROR("Load svg: " << SVGfilename << " ERROR!");
 		return;
 	}
 
 	XMLElement *root = svg.FirstChildElement("svg");
 
-	vector<XMLElement*> paths, lines, rects, polygens, polylines;
+	ScratchVector<XMLElement*> paths, lines, rects, polygens, polylines;
 	getElementList(paths, root, "path");
 	getElementList(lines, root, "line");
 	getElementList(rects, root, "rect");
@@ -544,43 +787,119 @@ void Pattern::loadSVG() {
 	
 	parseLine(lines);
 	parseRect(rects);
+	timer.addElements(lines.size() + rects.size());
+}
+
+void Pattern::loadCreases() {
+	StageTimer timer(stats, StageLoad, creases.size());
+	SubsystemScope scope(SubsystemGeometry);
+	for (const Edge &e : creases) {
+		if (e.type == NONE) continue;
+		int v1 = vertices.add(e.v1.x, e.v1.y);
+		int v2 = vertices.add(e.v2.x, e.v2.y);
+		edges.add(v1, v2, e.angle, e.type);
+	}
 }
 
 void Pattern::parseSVG() {
 	// remove duplicate vertices and edges
-	UniqueVertices(verticesRaw);
-	UniqueEdges(edgesRaw);
+	{
+		StageTimer timer(stats, StageDedupe, vertices.size() + edges.size());
+		SubsystemScope scope(SubsystemGeometry);
+		snapStep = options.snapGrid;
+		if (snapStep > 0 && !snapVertices(vertices, snapStep)) {
+			LOG_ERROR(SVGfilename << ": coordinates too large for a snap grid of " << snapStep
+				<< ", intersecting in float instead");
+			snapStep = 0;
+		}
+		UniqueVertices(vertices, edges);
+		UniqueEdges(edges);
+	}
 
-	findIntersections();
+	{
+		StageTimer timer(stats, StageIntersect, edges.size());
+		SubsystemScope scope(SubsystemGeometry);
+		findIntersections();
+	}
 
 	// remove duplicate vertices and edges
-	UniqueVertices(verticesRaw);
-	UniqueEdges(edgesRaw);
+	{
+		StageTimer timer(stats, StageDedupe, vertices.size() + edges.size());
+		SubsystemScope scope(SubsystemGeometry);
+		UniqueVertices(vertices, edges);
+		UniqueEdges(edges);
+	}
+
+	if (options.vertexOrder != OrderSorted) {
+		StageTimer timer(stats, StageReorder, vertices.size());
+		SubsystemScope scope(SubsystemTopology);
+		reorderVertices();
+	}
 
-	debugEdgeList(edgesRaw);
-	debugVerticeList(verticesRaw);
+	DEBUG_DUMP(debugEdgeList(vertices, edges));
+	DEBUG_DUMP(debugVerticeList(vertices));
 
 	// find counter-clockwise neighbor vertices for each vertice
-	findVerticeNeighbors();
-	sortVerticeNeighbors();
-	debugVerticeNeighbor(verticeNeighbors);
+	{
+		StageTimer timer(stats, StageNeighbors, vertices.size());
+		SubsystemScope scope(SubsystemTopology);
+		findVerticeNeighbors();
+		sortVerticeNeighbors();
+	}
+	DEBUG_DUMP(debugVerticeNeighbor(verticeNeighbors));
 
-	findFaces();
-	debugFaceList(facesRaw);
+	{
+		StageTimer timer(stats, StageFaces, edges.size());
+		SubsystemScope scope(SubsystemTopology);
+		findFaces();
+	}
+	DEBUG_DUMP(debugFaceList(cycles));
+	DEBUG_DUMP(debugHoleList(cycles));
 
-	triangulatePolys();
-	debugEdgeList(edgesRaw);
-	debugFaceList(facesRaw);
+	{
+		StageTimer timer(stats, StageTriangulate, cycles.size());
+		SubsystemScope scope(SubsystemTriangulation);
+		triangulatePolys();
+	}
+	DEBUG_DUMP(debugEdgeList(vertices, edges));
+	DEBUG_DUMP(debugTriangleList(triangles));
+
+	LOG_INFO(SVGfilename << ": " << vertices.size() << " vertices, "
+		<< edges.size() << " edges, " << triangles.size() << " faces");
+}
+
+void Pattern::clearResult() {
+	vertices.clear();
+	edges.clear();
+	segments.clear();
+	verticeNeighbors.clear();
+	cycles.clear();
+	triangles.clear();
+}
+
+void Pattern::reset(string filename) {
+	SVGfilename.swap(filename);
+	creases.clear();
+	fromMemory = false;
+	clearResult();
+}
+
+void Pattern::reset(const vector<Edge> &edges, string name) {
+	SVGfilename.swap(name);
+	creases.assign(edges.begin(), edges.end());
+	fromMemory = true;
+	clearResult();
 }
 
 void Pattern::parse() {
-	loadSVG();	
+	stats.clear();
+	clearResult();
+	SubsystemAccounting accounting(stats);
+	ScratchScope scratch;
+	if (fromMemory)
+		loadCreases();
+	else
+		loadSVG();	
 	parseSVG();	
 	
 }
-
-int main() {
-	Pattern p("../assets/Bases/boatBase.svg");
-	p.parse();
-	cin.get();
-}
\ No newline at end of file
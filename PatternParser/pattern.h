@@ -7,6 +7,8 @@
 #include<map>
 #include<sstream>
 #include "tinyxml2.h"
+#include "stats.h"
+#include "intersect.h"
 
 using namespace std;
 using namespace tinyxml2;
@@ -21,11 +23,11 @@ public:
 	float x, y, z;
 	int id;
 	Vertice(float _x, float _y, float _z)
-		:x(_x), y(_y), z(_z) {}
+		:x(_x), y(_y), z(_z), id(-1) {}
 	Vertice(float _x, float _y)
-		:x(_x), y(_y), z(0) {}
+		:x(_x), y(_y), z(0), id(-1) {}
 	Vertice()
-		:x(0), y(0), z(0) {}
+		:x(0), y(0), z(0), id(-1) {}
 	Vertice(const Vertice &other)
 		:x(other.x), y(other.y), z(other.z), id(other.id){}
 	bool operator==(const Vertice &other) const {
@@ -50,37 +52,75 @@ public:
 	}
 };
 
-class Face
-{
-public:
-	vector<Vertice> vts;
-	Face(){}
-	Face(vector<Vertice> v) :vts(v) {}
-};
-
 
 
 const float	VERT_TOL = 3.0f;	//vertex merge tolerance
+const float	COLLINEAR_TOL = 0.01f;	//max distance of an endpoint from a line it overlaps
+const float	COLLINEAR_ANGLE = 0.001f;	//max direction difference (radians) of overlapping edges
 const float	NULL_DIST = -99.9f;	//represent NULL when comparing distance
 
+enum INTERSECT_MODE {
+	IntersectSerial,	// all pairs on the calling thread
+	IntersectTiled		// spatial tiles searched on the thread pool
+};
+
+enum FACE_MODE {
+	FacesSerial,	// half-edge cycles walked on the calling thread
+	FacesParallel	// slot ranges walked on the thread pool (faces.h)
+};
+
+// Scalar policy (geom.h) for the angle sort of each vertex's neighbours and
+// the diagonal choice when a quad is split. Only these two steps use it:
+// vertices are stored as float and intersections are found in float (or
+// in integers with snapGrid) whatever the setting. Both steps are a small
+// part of a parse, so this is not a speed/precision trade-off for it.
+enum ANGLE_PRECISION {
+	PrecisionFloat,		// FloatPolicy
+	PrecisionDouble		// DoublePolicy
+};
+
+// Vertex numbering handed to the topology stages.
+enum VERTEX_ORDER {
+	OrderSorted,	// by (x, y), as dedupe leaves them
+	OrderMorton,	// along a Z-order curve (reorder.h)
+	OrderRCM		// reverse Cuthill-McKee over the crease graph, narrows the bandwidth
+};
+
+struct ParseOptions {
+	INTERSECT_MODE intersect;
+	FACE_MODE faces;
+	int threads;	// pool size for IntersectTiled and FacesParallel, 0 = one per core
+	double snapGrid;	// > 0: snap to multiples of this and intersect in integers, serially (snap.h)
+	ANGLE_PRECISION anglePrecision;
+	VERTEX_ORDER vertexOrder;
+	ParseOptions() :intersect(IntersectSerial), faces(FacesSerial), threads(0), snapGrid(0), anglePrecision(PrecisionFloat),
+		vertexOrder(OrderSorted) {}
+};
+
 class Pattern {
 private:
 	string SVGfilename;
-
-	vector<Vertice> verticesRaw;
-	vector<Edge> edgesRaw;
-	vector<vector<Vertice>> verticeNeighbors;	// vertex id - neighbor ids
-	vector<Face> facesRaw;
-
-	void getElementList(vector<XMLElement*> &vec, XMLElement *root, string name);
+	vector<Edge> creases;	// in-memory source, used instead of SVGfilename
+	bool fromMemory;
+	double snapStep;	// grid of the last parse, 0 when it ran in float
+
+	VertexArray vertices;
+	EdgeArray edges;	// endpoints index into vertices
+	SegmentArray segments;	// edge geometry for the crossing search
+	NeighborArray verticeNeighbors;	// vertex id - neighbor ids
+	FaceArray cycles;	// every face cycle, classified (faces.h)
+	TriangleArray triangles;	// interior faces after triangulation
+
+	void getElementList(ScratchVector<XMLElement*> &vec, XMLElement *root, string name);
 	float getOpacityAngle(XMLElement* e);
 	const string getStroke(XMLElement* e);
 	TYPE typeForStroke(const string stroke);
 
-	void parseLine(vector<XMLElement*> &vec);
-	void parseRect(vector<XMLElement*> &vec);
+	void parseLine(ScratchVector<XMLElement*> &vec);
+	void parseRect(ScratchVector<XMLElement*> &vec);
 
 	void findIntersections();
+	void reorderVertices();
 	void findVerticeNeighbors();
 	void sortVerticeNeighbors();
 	void findFaces();	
@@ -88,7 +128,9 @@ private:
 	void triangulatePolys();
 
 	void loadSVG();
+	void loadCreases();
 	void parseSVG();
+	void clearResult();
 
 public:
 	vector<Edge> mountains;
@@ -97,8 +139,27 @@ public:
 	vector<Edge> hinges;
 	vector<Edge> triangulations;
 
+	ParseOptions options;	// read by parse()
+	ParseStats stats;	// per-stage timings of the last parse()
+
+	// The planar graph of the last parse(): vertices and the edges between them.
+	const VertexArray &vertexArray() const { return vertices; }
+	const EdgeArray &edgeArray() const { return edges; }
+
+	// Faces, outer boundaries and holes of the last parse(), before triangulation.
+	const FaceArray &faceCycles() const { return cycles; }
+	// The interior faces as triangles.
+	const TriangleArray &faceTriangles() const { return triangles; }
+
 	Pattern(string filename)
-		:SVGfilename(filename){}
+		:SVGfilename(filename), fromMemory(false), snapStep(0) {}
+	Pattern(const vector<Edge> &edges, string name = "<memory>")
+		:SVGfilename(name), creases(edges), fromMemory(true), snapStep(0) {}
+
+	// Switches to another source and drops the last result; the containers
+	// keep their capacity, so a reused Pattern parses a batch with few allocations.
+	void reset(string filename);
+	void reset(const vector<Edge> &edges, string name = "<memory>");
 	
 	void parse();
 };
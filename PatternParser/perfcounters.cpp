@@ -0,0 +1,152 @@
+#include "perfcounters.h"
+#include <cstring>
+#include <atomic>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#define HAVE_PERF_EVENT 1
+#define HAVE_RUSAGE 1
+#elif defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#define HAVE_RUSAGE 1
+#endif
+
+static std::atomic<bool> enabledFlag(false);
+
+void setPerfCountersEnabled(bool enabled) {
+	enabledFlag = enabled;
+}
+
+bool perfCountersEnabled() {
+	return enabledFlag;
+}
+
+const char *perfCounterName(PERF_COUNTER c) {
+	static const char *names[] = {
+		"cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses",
+		"cpu_time_ns", "page_faults", "context_switches"
+	};
+	return c < PERF_COUNTER_COUNT ? names[c] : "unknown";
+}
+
+#ifdef HAVE_PERF_EVENT
+static int openEvent(unsigned type, unsigned long long config, int group) {
+	perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = type;
+	attr.config = config;
+	attr.disabled = group == -1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+	return (int)syscall(__NR_perf_event_open, &attr, 0, -1, group, 0);
+}
+#endif
+
+PerfCounters::PerfCounters()
+	:mode(PerfOff), available(0), groupFd(-1), opened(0) {
+	for (int i = 0; i < PERF_COUNTER_COUNT; i++)
+		fds[i] = -1;
+	if (openHardware()) {
+		mode = PerfHardware;
+		return;
+	}
+#ifdef HAVE_RUSAGE
+	mode = PerfSoftware;
+	available = (1u << PerfCPUTimeNs) | (1u << PerfPageFaults) | (1u << PerfContextSwitches);
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+	closeAll();
+}
+
+PerfCounters &PerfCounters::forThread() {
+	static thread_local PerfCounters counters;
+	return counters;
+}
+
+bool PerfCounters::openHardware() {
+#ifdef HAVE_PERF_EVENT
+	const unsigned long long cache = PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+	struct { PERF_COUNTER counter; unsigned type; unsigned long long config; } events[] = {
+		{ PerfCycles, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+		{ PerfInstructions, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+		{ PerfL1DMisses, PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | cache },
+		{ PerfLLCMisses, PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | cache },
+		{ PerfBranchMisses, PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+	};
+	// cycles lead the group; any other event the PMU lacks is just left out
+	for (auto &e : events) {
+		int fd = openEvent(e.type, e.config, groupFd);
+		if (fd < 0) {
+			if (groupFd < 0) return false;
+			continue;
+		}
+		if (groupFd < 0) groupFd = fd;
+		fds[opened++] = fd;
+		available |= 1u << e.counter;
+	}
+	ioctl(groupFd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(groupFd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	return true;
+#else
+	return false;
+#endif
+}
+
+void PerfCounters::closeAll() {
+#ifdef HAVE_PERF_EVENT
+	for (int i = 0; i < opened; i++)
+		close(fds[i]);
+#endif
+	opened = 0;
+	groupFd = -1;
+}
+
+void PerfCounters::read(PerfSample &sample) {
+	memset(&sample, 0, sizeof(sample));
+#ifdef HAVE_PERF_EVENT
+	if (mode == PerfHardware) {
+		// nr, time_enabled, time_running, value[nr]
+		unsigned long long buf[3 + PERF_COUNTER_COUNT];
+		if (::read(groupFd, buf, sizeof(buf)) < (ssize_t)(3 * sizeof(buf[0])))
+			return;
+		double scale = buf[2] && buf[2] < buf[1] ? (double)buf[1] / buf[2] : 1.0;	// multiplexed
+		int k = 0;
+		for (int c = 0; c < PERF_COUNTER_COUNT && k < (int)buf[0]; c++) {
+			if (has((PERF_COUNTER)c))
+				sample.values[c] = (unsigned long long)(buf[3 + k++] * scale);
+		}
+		return;
+	}
+#endif
+#ifdef HAVE_RUSAGE
+	if (mode == PerfSoftware) {
+		rusage ru;
+#ifdef RUSAGE_THREAD
+		getrusage(RUSAGE_THREAD, &ru);
+#else
+		getrusage(RUSAGE_SELF, &ru);
+#endif
+#ifdef CLOCK_THREAD_CPUTIME_ID
+		// rusage times are often only tick-accurate
+		timespec ts;
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+		sample.values[PerfCPUTimeNs] = ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#else
+		unsigned long long us = (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000ULL
+			+ ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
+		sample.values[PerfCPUTimeNs] = us * 1000;
+#endif
+		sample.values[PerfPageFaults] = ru.ru_minflt + ru.ru_majflt;
+		sample.values[PerfContextSwitches] = ru.ru_nvcsw + ru.ru_nivcsw;
+	}
+#endif
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+/*
+ * Optional hardware performance counters around pipeline stages.
+ *
+ * On Linux the hardware events are read through perf_event_open as one
+ * group. When that is not possible (no PMU in a VM, perf_event_paranoid,
+ * other platforms) the software counters from getrusage() are used instead,
+ * and on platforms without either nothing is reported.
+ * Counters only cover the calling thread.
+ */
+
+enum PERF_COUNTER {
+	PerfCycles, PerfInstructions, PerfL1DMisses, PerfLLCMisses, PerfBranchMisses,	// hardware
+	PerfCPUTimeNs, PerfPageFaults, PerfContextSwitches,	// software fallback
+	PERF_COUNTER_COUNT
+};
+
+enum PERF_MODE {
+	PerfOff, PerfHardware, PerfSoftware
+};
+
+const char *perfCounterName(PERF_COUNTER c);
+
+struct PerfSample {
+	unsigned long long values[PERF_COUNTER_COUNT];
+};
+
+class PerfCounters {
+private:
+	PERF_MODE mode;
+	unsigned available;	// bit per PERF_COUNTER
+	int fds[PERF_COUNTER_COUNT];
+	int groupFd;
+	int opened;
+
+	bool openHardware();
+	void closeAll();
+
+public:
+	PerfCounters();
+	~PerfCounters();
+
+	// Counters of the calling thread; opened on first use.
+	static PerfCounters &forThread();
+
+	PERF_MODE getMode() const { return mode; }
+	bool has(PERF_COUNTER c) const { return (available >> c) & 1; }
+	void read(PerfSample &sample);
+};
+
+// Global switch, off by default since every read is a system call.
+void setPerfCountersEnabled(bool enabled);
+bool perfCountersEnabled();
@@ -0,0 +1,179 @@
+#include "predicates.h"
+#include <cmath>
+#include <vector>
+
+/*
+ * Expansion arithmetic. An expansion is an array of doubles, smallest
+ * magnitude first, whose exact sum is the value; components do not overlap
+ * and zeros are dropped, so the sign is the sign of the last component.
+ */
+
+static const double EPS = 1.1102230246251565e-16;	// 2^-53
+static const double CCW_ERRBOUND = (3.0 + 16.0 * EPS) * EPS;
+
+static inline void twoSum(double a, double b, double &x, double &y) {
+	x = a + b;
+	double bv = x - a;
+	double av = x - bv;
+	y = (a - av) + (b - bv);
+}
+
+static inline void twoDiff(double a, double b, double &x, double &y) {
+	x = a - b;
+	double bv = a - x;
+	double av = x + bv;
+	y = (a - av) + (bv - b);
+}
+
+static inline void twoProduct(double a, double b, double &x, double &y) {
+	x = a * b;
+	y = std::fma(a, b, -x);
+}
+
+// h = e + b; h may not alias e.
+static int growExpansion(int elen, const double *e, double b, double *h) {
+	int hlen = 0;
+	double q = b;
+	for (int i = 0; i < elen; i++) {
+		double sum, err;
+		twoSum(q, e[i], sum, err);
+		q = sum;
+		if (err != 0)
+			h[hlen++] = err;
+	}
+	if (q != 0 || hlen == 0)
+		h[hlen++] = q;
+	return hlen;
+}
+
+// h = e + f; h needs elen + flen slots.
+static int sumExpansion(int elen, const double *e, int flen, const double *f, double *h) {
+	double buf[2][64];
+	int len = elen;
+	const double *cur = e;
+	for (int i = 0; i < flen; i++) {
+		double *out = i == flen - 1 ? h : buf[i & 1];
+		len = growExpansion(len, cur, f[i], out);
+		cur = out;
+	}
+	if (flen == 0) {
+		for (int i = 0; i < elen; i++)
+			h[i] = e[i];
+	}
+	return len;
+}
+
+// h = e * b; h needs 2 * elen slots.
+static int scaleExpansion(int elen, const double *e, double b, double *h) {
+	int hlen = 0;
+	double q, lo;
+	twoProduct(e[0], b, q, lo);
+	if (lo != 0)
+		h[hlen++] = lo;
+	for (int i = 1; i < elen; i++) {
+		double p1, p0, sum, err;
+		twoProduct(e[i], b, p1, p0);
+		twoSum(q, p0, sum, err);
+		if (err != 0)
+			h[hlen++] = err;
+		twoSum(p1, sum, q, err);
+		if (err != 0)
+			h[hlen++] = err;
+	}
+	if (q != 0 || hlen == 0)
+		h[hlen++] = q;
+	return hlen;
+}
+
+static double estimate(int elen, const double *e) {
+	double sum = 0;
+	for (int i = 0; i < elen; i++)
+		sum += e[i];
+	return sum;
+}
+
+static int expansionSign(int elen, const double *e) {
+	double top = e[elen - 1];
+	return top > 0 ? 1 : top < 0 ? -1 : 0;
+}
+
+// (a - b)(c - d) - (e - f)(g - h) as an expansion of at most 16 components.
+static int crossExpansion(double a, double b, double c, double d,
+	double e, double f, double g, double h, double *out) {
+	double ab[2], cd[2], ef[2], gh[2];
+	twoDiff(a, b, ab[1], ab[0]);
+	twoDiff(c, d, cd[1], cd[0]);
+	twoDiff(e, f, ef[1], ef[0]);
+	twoDiff(g, h, gh[1], gh[0]);
+	gh[0] = -gh[0];
+	gh[1] = -gh[1];
+
+	double s0[4], s1[4], left[8], right[8];
+	int n0 = scaleExpansion(2, ab, cd[0], s0);
+	int n1 = scaleExpansion(2, ab, cd[1], s1);
+	int nl = sumExpansion(n0, s0, n1, s1, left);
+	n0 = scaleExpansion(2, ef, gh[0], s0);
+	n1 = scaleExpansion(2, ef, gh[1], s1);
+	int nr = sumExpansion(n0, s0, n1, s1, right);
+	return sumExpansion(nl, left, nr, right, out);
+}
+
+int crossSign(float ax, float bx, float cy, float dy, float ay, float by, float cx, float dx) {
+	double left = ((double)ax - bx) * ((double)cy - dy);
+	double right = ((double)ay - by) * ((double)cx - dx);
+	double det = left - right;
+	double bound = CCW_ERRBOUND * (fabs(left) + fabs(right));
+	if (det > bound) return 1;
+	if (-det > bound) return -1;
+
+	double e[16];
+	int n = crossExpansion(ax, bx, cy, dy, ay, by, cx, dx, e);
+	return expansionSign(n, e);
+}
+
+int orient2d(float ax, float ay, float bx, float by, float cx, float cy) {
+	return crossSign(ax, cx, by, cy, ay, cy, bx, cx);
+}
+
+bool lineIntersectExact(float x1, float y1, float x2, float y2,
+	float x3, float y3, float x4, float y4, double &t1, double &t2) {
+	double den[16], num1[16], num2[16];
+	int nd = crossExpansion(y4, y3, x2, x1, x4, x3, y2, y1, den);
+	if (expansionSign(nd, den) == 0) {
+		t1 = t2 = 0;
+		return false;
+	}
+	int n1 = crossExpansion(x4, x3, y1, y3, y4, y3, x1, x3, num1);
+	int n2 = crossExpansion(x2, x1, y1, y3, y2, y1, x1, x3, num2);
+	double d = estimate(nd, den);
+	t1 = estimate(n1, num1) / d;
+	t2 = estimate(n2, num2) / d;
+	return true;
+}
+
+int polygonOrientationExact(const float *x, const float *y, const int *idx, int n) {
+	// products of two floats are exact in double, only the sum rounds
+	double sum = 0, magnitude = 0;
+	for (int i = 0; i < n; i++) {
+		int a = idx[i], b = idx[(i + 1) % n];
+		double p = (double)x[a] * y[b], q = (double)x[b] * y[a];
+		sum += p - q;
+		magnitude += fabs(p) + fabs(q);
+	}
+	return polygonOrientationExact(x, y, idx, n, sum, magnitude);
+}
+
+int polygonOrientationExact(const float *x, const float *y, const int *idx, int n, double sum, double magnitude) {
+	double bound = (2.0 * n + 2.0) * EPS * magnitude;
+	if (sum > bound) return 1;
+	if (-sum > bound) return -1;
+
+	std::vector<double> e(2 * n + 1), h(2 * n + 1);
+	int len = 0;
+	for (int i = 0; i < n; i++) {
+		int a = idx[i], b = idx[(i + 1) % n];
+		len = growExpansion(len, e.data(), (double)x[a] * y[b], h.data());
+		len = growExpansion(len, h.data(), -(double)x[b] * y[a], e.data());
+	}
+	return len ? expansionSign(len, e.data()) : 0;
+}
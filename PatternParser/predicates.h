@@ -0,0 +1,39 @@
+#pragma once
+
+/*
+ * Robust geometric predicates.
+ *
+ * Each predicate first evaluates in double precision with an error bound;
+ * only when the result lies inside the bound is it recomputed exactly with
+ * floating-point expansions (Shewchuk, "Adaptive Precision Floating-Point
+ * Arithmetic and Fast Robust Geometric Predicates"). Inputs are floats, so
+ * every product of two coordinates is exact in double and the exact path
+ * stays short.
+ */
+
+// Sign of (ax - bx)(cy - dy) - (ay - by)(cx - dx), computed exactly.
+int crossSign(float ax, float bx, float cy, float dy, float ay, float by, float cx, float dx);
+
+// Orientation of c relative to the line a -> b: +1 left, -1 right, 0 on it.
+int orient2d(float ax, float ay, float bx, float by, float cx, float cy);
+
+/*
+ * Crossing parameters of the lines through (x1, y1)-(x2, y2) and
+ * (x3, y3)-(x4, y4), from determinants evaluated exactly and rounded once.
+ * Returns false when the lines are exactly parallel.
+ */
+bool lineIntersectExact(float x1, float y1, float x2, float y2,
+	float x3, float y3, float x4, float y4, double &t1, double &t2);
+
+/*
+ * Sign of twice the signed area of the polygon idx[0..n) over x/y, with the
+ * same convention as twiceSignedArea(): negative for counterclockwise.
+ */
+int polygonOrientationExact(const float *x, const float *y, const int *idx, int n);
+
+/*
+ * Same, for a caller that already summed the terms x[a] * y[b] - x[b] * y[a]
+ * in double (sum) along with their magnitudes |x[a] * y[b]| + |x[b] * y[a]|
+ * (magnitude); the polygon is only revisited when they cannot decide.
+ */
+int polygonOrientationExact(const float *x, const float *y, const int *idx, int n, double sum, double magnitude);
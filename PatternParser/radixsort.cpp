@@ -0,0 +1,25 @@
+#include "radixsort.h"
+
+void radixSort(ScratchVector<unsigned long long> &keys, ScratchVector<int> &index) {
+	size_t n = keys.size();
+	if (n < 2)
+		return;
+	ScratchVector<unsigned long long> keyTmp(n);
+	ScratchVector<int> indexTmp(n);
+	for (int shift = 0; shift < 64; shift += 8) {
+		size_t count[257] = { 0 };
+		for (size_t i = 0; i < n; i++)
+			count[((keys[i] >> shift) & 0xff) + 1]++;
+		if (count[((keys[0] >> shift) & 0xff) + 1] == n)
+			continue;
+		for (int b = 0; b < 256; b++)
+			count[b + 1] += count[b];
+		for (size_t i = 0; i < n; i++) {
+			size_t dst = count[(keys[i] >> shift) & 0xff]++;
+			keyTmp[dst] = keys[i];
+			indexTmp[dst] = index[i];
+		}
+		keys.swap(keyTmp);
+		index.swap(indexTmp);
+	}
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <cstring>
+#include "arena.h"
+
+/*
+ * Stable LSD radix sort of (key, index) pairs by key, one byte per pass.
+ * A pass is skipped when every key has the same byte there, so keys that
+ * only use their low bits cost only the passes they need.
+ */
+void radixSort(ScratchVector<unsigned long long> &keys, ScratchVector<int> &index);
+
+// Unsigned key in the same order as the float; -0 and +0 share a key.
+inline unsigned floatKey(float v) {
+	if (v == 0)
+		v = 0;
+	unsigned bits;
+	memcpy(&bits, &v, sizeof(bits));
+	return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+}
@@ -0,0 +1,117 @@
+#include "reorder.h"
+#include <algorithm>
+#include <cstdlib>
+#include "radixsort.h"
+
+// Spreads the low 16 bits of v to the even bit positions.
+static unsigned spreadBits(unsigned v) {
+	v &= 0xffff;
+	v = (v | (v << 8)) & 0x00ff00ff;
+	v = (v | (v << 4)) & 0x0f0f0f0f;
+	v = (v | (v << 2)) & 0x33333333;
+	v = (v | (v << 1)) & 0x55555555;
+	return v;
+}
+
+void mortonOrder(const VertexArray &vts, ScratchVector<int> &order) {
+	int n = vts.size();
+	order.resize(n);
+	if (n == 0)
+		return;
+	float minX = vts.x[0], maxX = vts.x[0], minY = vts.y[0], maxY = vts.y[0];
+	for (int i = 1; i < n; i++) {
+		minX = std::min(minX, vts.x[i]);
+		maxX = std::max(maxX, vts.x[i]);
+		minY = std::min(minY, vts.y[i]);
+		maxY = std::max(maxY, vts.y[i]);
+	}
+	// one scale for both axes keeps the cells square
+	double extent = std::max(maxX - minX, maxY - minY);
+	double scale = extent > 0 ? 65535.0 / extent : 0;
+
+	ScratchVector<unsigned long long> keys(n);
+	for (int i = 0; i < n; i++) {
+		unsigned cx = (unsigned)((vts.x[i] - minX) * scale);
+		unsigned cy = (unsigned)((vts.y[i] - minY) * scale);
+		keys[i] = spreadBits(cx) | spreadBits(cy) << 1;
+		order[i] = i;
+	}
+	radixSort(keys, order);
+}
+
+/*
+ * Breadth-first from root over unvisited vertices, appending them to order
+ * and leaving their depth in level. Returns the index in order where the
+ * deepest level starts.
+ */
+static int bfs(const NeighborArray &adj, int root, ScratchVector<char> &visited, ScratchVector<int> &level,
+	ScratchVector<int> &order) {
+	int first = order.size(), deepest = first;
+	order.push_back(root);
+	visited[root] = 1;
+	level[root] = 0;
+	for (size_t i = first; i < order.size(); i++) {
+		int v = order[i];
+		if (level[v] != level[order[deepest]])
+			deepest = i;
+		for (const int *k = adj.begin(v); k != adj.end(v); k++) {
+			int w = *k;
+			if (visited[w]) continue;
+			visited[w] = 1;
+			level[w] = level[v] + 1;
+			order.push_back(w);
+		}
+	}
+	return deepest;
+}
+
+void rcmOrder(const VertexArray &vts, const EdgeArray &edges, ScratchVector<int> &order) {
+	int n = vts.size();
+	NeighborArray adj;
+	adj.build(n, edges);
+	// neighbors by increasing degree, ties by id, so the order is deterministic
+	for (int v = 0; v < n; v++) {
+		std::sort(adj.begin(v), adj.end(v), [&](int a, int b) {
+			int da = adj.degree(a), db = adj.degree(b);
+			return da != db ? da < db : a < b;
+		});
+	}
+
+	order.clear();
+	order.reserve(n);
+	ScratchVector<char> visited(n, 0), probed(n, 0);
+	ScratchVector<int> level(n), component;
+	for (int seed = 0; seed < n; seed++) {
+		if (visited[seed]) continue;
+		// George-Liu: move to a least-degree vertex of the deepest level while
+		// that makes the level structure deeper
+		int root = seed, depth = -1;
+		for (;;) {
+			component.clear();
+			int deepest = bfs(adj, root, probed, level, component);
+			for (int v : component)
+				probed[v] = 0;
+			int rootDepth = level[component.back()];
+			if (rootDepth <= depth)
+				break;
+			depth = rootDepth;
+			int best = component[deepest];
+			for (size_t i = deepest; i < component.size(); i++) {
+				int v = component[i];
+				if (adj.degree(v) < adj.degree(best)) best = v;
+			}
+			if (best == root)
+				break;
+			root = best;
+		}
+		bfs(adj, root, visited, level, order);
+	}
+	std::reverse(order.begin(), order.end());
+}
+
+int bandwidth(const EdgeArray &edges) {
+	int band = 0, m = edges.size();
+	for (int i = 0; i < m; i++)
+		band = std::max(band, std::abs(edges.v0[i] - edges.v1[i]));
+	return band;
+}
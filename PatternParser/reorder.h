@@ -0,0 +1,21 @@
+#pragma once
+#include "arena.h"
+
+/*
+ * Vertex orderings for locality. Each fills order with a permutation of the
+ * vertex ids: order[k] is the old id of the vertex that becomes vertex k.
+ */
+
+// Along a Morton (Z-order) curve over the bounding box, 16 bits per axis.
+void mortonOrder(const VertexArray &vts, ScratchVector<int> &order);
+
+/*
+ * Reverse Cuthill-McKee over the crease graph: breadth-first from a
+ * pseudo-peripheral vertex of each component, neighbors by increasing
+ * degree, then reversed. Keeps the ids of adjacent vertices close, which
+ * narrows the band of matrices indexed by vertex.
+ */
+void rcmOrder(const VertexArray &vts, const EdgeArray &edges, ScratchVector<int> &order);
+
+// Largest id difference between the two ends of an edge.
+int bandwidth(const EdgeArray &edges);
@@ -0,0 +1,293 @@
+#include "snap.h"
+#include <algorithm>
+#include <set>
+#include <unordered_map>
+#include <vector>
+#include "arena.h"
+
+static unsigned long long gridKey(GridPoint p) {
+	return ((unsigned long long)(unsigned)p.x << 32) | (unsigned)p.y;
+}
+
+static long long cross(long long ax, long long ay, long long bx, long long by) {
+	return ax * by - ay * bx;
+}
+
+bool snapVertices(VertexArray &vts, double step) {
+	int n = vts.size();
+	double limit = GRID_LIMIT - 0.5;	// llround() stays below GRID_LIMIT
+	for (int i = 0; i < n; i++) {
+		if (!(fabs(vts.x[i] / step) < limit && fabs(vts.y[i] / step) < limit))
+			return false;	// also catches NaN and a zero step
+	}
+	for (int i = 0; i < n; i++) {
+		GridPoint p = toGrid(vts.x[i], vts.y[i], step);
+		vts.x[i] = (float)(p.x * step);
+		vts.y[i] = (float)(p.y * step);
+	}
+	return true;
+}
+
+bool angleGreater(GridPoint o, GridPoint a, GridPoint b) {
+	long long ax = a.x - o.x, ay = a.y - o.y;
+	long long bx = b.x - o.x, by = b.y - o.y;
+	// atan2 is in (-pi, pi]: the upper half plane, with the negative x axis, comes first
+	bool upperA = ay > 0 || (ay == 0 && ax < 0);
+	bool upperB = by > 0 || (by == 0 && bx < 0);
+	if (upperA != upperB)
+		return upperA;
+	return cross(ax, ay, bx, by) < 0;
+}
+
+static long long dot(long long ax, long long ay, long long bx, long long by) {
+	return ax * bx + ay * by;
+}
+
+static int findGroup(ScratchVector<int> &parent, int e) {
+	while (parent[e] != e) {
+		parent[e] = parent[parent[e]];
+		e = parent[e];
+	}
+	return e;
+}
+
+/*
+ * Merges collinear edges that overlap, like mergeCollinear() in the float
+ * path but exact: two edges are on one line when both cross products with
+ * its direction are zero, and overlap when their projections on it share
+ * more than a point. Each group of overlapping edges is cut at all of its
+ * endpoints and every piece is emitted once, typed by the highest priority
+ * edge covering it; the other edges keep their order and the pieces follow.
+ */
+static void mergeOverlaps(const ScratchVector<GridPoint> &pts, EdgeArray &edges, const unsigned char *typeRank) {
+	int ne = edges.size();
+	ScratchVector<long long> minX(ne), maxX(ne), minY(ne), maxY(ne);
+	ScratchVector<int> order(ne), parent(ne);
+	for (int e = 0; e < ne; e++) {
+		GridPoint a = pts[edges.v0[e]], b = pts[edges.v1[e]];
+		minX[e] = std::min(a.x, b.x);
+		maxX[e] = std::max(a.x, b.x);
+		minY[e] = std::min(a.y, b.y);
+		maxY[e] = std::max(a.y, b.y);
+		order[e] = e;
+		parent[e] = e;
+	}
+	std::sort(order.begin(), order.end(), [&minX](int a, int b) {
+		return minX[a] != minX[b] ? minX[a] < minX[b] : a < b;
+	});
+
+	bool overlap = false;
+	for (int a = 0; a < ne; a++) {
+		int i = order[a];
+		for (int b = a + 1; b < ne && minX[order[b]] <= maxX[i]; b++) {
+			int j = order[b];
+			if (maxY[j] < minY[i] || minY[j] > maxY[i])
+				continue;
+			GridPoint A = pts[edges.v0[i]], B = pts[edges.v1[i]];
+			GridPoint C = pts[edges.v0[j]], D = pts[edges.v1[j]];
+			long long rx = B.x - A.x, ry = B.y - A.y;
+			if (cross(rx, ry, D.x - C.x, D.y - C.y) != 0 || cross(C.x - A.x, C.y - A.y, rx, ry) != 0)
+				continue;
+			long long c = dot(C.x - A.x, C.y - A.y, rx, ry), d = dot(D.x - A.x, D.y - A.y, rx, ry);
+			if (std::min(std::max(c, d), dot(rx, ry, rx, ry)) <= std::max(std::min(c, d), 0LL))
+				continue;	// apart, or touching end to end
+			int gi = findGroup(parent, i), gj = findGroup(parent, j);
+			if (gi < gj) parent[gj] = gi;
+			else parent[gi] = gj;
+			overlap = true;
+		}
+	}
+	if (!overlap)
+		return;
+
+	// members of a group are consecutive, the group's lowest edge first
+	ScratchVector<int> group(ne);
+	for (int e = 0; e < ne; e++) {
+		group[e] = findGroup(parent, e);
+		order[e] = e;
+	}
+	std::sort(order.begin(), order.end(), [&group](int a, int b) {
+		return group[a] != group[b] ? group[a] < group[b] : a < b;
+	});
+
+	ScratchEdgeArray out, merged;
+	out.reserve(ne);
+	ScratchVector<std::pair<long long, int>> points;	// (projection, vertex)
+	struct Span { int from, to, rank, edge; };
+	ScratchVector<Span> spans;
+	std::set<std::pair<int, int>, std::less<std::pair<int, int>>, ScratchAllocator<std::pair<int, int>>> active;	// (rank, span)
+	for (int first = 0; first < ne;) {
+		int end = first + 1;
+		while (end < ne && group[order[end]] == group[order[first]])
+			end++;
+		if (end - first == 1) {
+			int e = order[first];
+			out.add(edges.v0[e], edges.v1[e], edges.angle[e], edges.type[e]);
+			first = end;
+			continue;
+		}
+
+		int ref = order[first];
+		GridPoint A = pts[edges.v0[ref]], B = pts[edges.v1[ref]];
+		long long rx = B.x - A.x, ry = B.y - A.y;
+		points.clear();
+		for (int k = first; k < end; k++) {
+			int e = order[k];
+			for (int v : { edges.v0[e], edges.v1[e] })
+				points.push_back(std::make_pair(dot(pts[v].x - A.x, pts[v].y - A.y, rx, ry), v));
+		}
+		std::sort(points.begin(), points.end());
+		points.erase(std::unique(points.begin(), points.end()), points.end());
+
+		spans.clear();
+		for (int k = first; k < end; k++) {
+			int e = order[k];
+			int a = std::lower_bound(points.begin(), points.end(), std::make_pair(
+				dot(pts[edges.v0[e]].x - A.x, pts[edges.v0[e]].y - A.y, rx, ry), edges.v0[e])) - points.begin();
+			int b = std::lower_bound(points.begin(), points.end(), std::make_pair(
+				dot(pts[edges.v1[e]].x - A.x, pts[edges.v1[e]].y - A.y, rx, ry), edges.v1[e])) - points.begin();
+			Span span = { std::min(a, b), std::max(a, b), typeRank[edges.type[e]], e };
+			spans.push_back(span);
+		}
+		// sweep the pieces; spans that ended are dropped once they reach the front
+		std::sort(spans.begin(), spans.end(), [](const Span &a, const Span &b) {
+			return a.from != b.from ? a.from < b.from : a.edge < b.edge;
+		});
+		active.clear();
+		size_t next = 0;
+		for (int k = 0; k + 1 < (int)points.size(); k++) {
+			for (; next < spans.size() && spans[next].from == k; next++)
+				active.insert(std::make_pair(spans[next].rank, (int)next));
+			while (!active.empty() && spans[active.begin()->second].to <= k)
+				active.erase(active.begin());
+			if (active.empty())
+				continue;
+			int e = spans[active.begin()->second].edge;
+			int a = points[k].second, b = points[k + 1].second;
+			merged.add(std::min(a, b), std::max(a, b), edges.angle[e], edges.type[e]);
+		}
+		first = end;
+	}
+	for (int e = 0; e < (int)merged.size(); e++)
+		out.add(merged.v0[e], merged.v1[e], merged.angle[e], merged.type[e]);
+	edges.assign(out);
+}
+
+// A split point along an edge, ordered by its projection on the edge.
+struct GridHit {
+	int edge;
+	long long along;
+	int vertex;
+};
+
+void splitSnapped(VertexArray &vts, EdgeArray &edges, double step, const unsigned char *typeRank) {
+	int nv = vts.size();
+	typedef std::unordered_map<unsigned long long, int, std::hash<unsigned long long>, std::equal_to<unsigned long long>,
+		ScratchAllocator<std::pair<const unsigned long long, int>>> GridIndex;
+	ScratchVector<GridPoint> pts(nv);
+	GridIndex index;
+	index.reserve(nv * 2);
+	for (int v = 0; v < nv; v++) {
+		pts[v] = toGrid(vts.x[v], vts.y[v], step);
+		index.insert(std::make_pair(gridKey(pts[v]), v));
+	}
+	int ne = edges.size();
+
+	ScratchVector<long long> minX(ne), maxX(ne), minY(ne), maxY(ne);
+	ScratchVector<int> order(ne);
+	for (int e = 0; e < ne; e++) {
+		GridPoint a = pts[edges.v0[e]], b = pts[edges.v1[e]];
+		minX[e] = std::min(a.x, b.x);
+		maxX[e] = std::max(a.x, b.x);
+		minY[e] = std::min(a.y, b.y);
+		maxY[e] = std::max(a.y, b.y);
+		order[e] = e;
+	}
+	std::sort(order.begin(), order.end(), [&minX](int a, int b) {
+		return minX[a] != minX[b] ? minX[a] < minX[b] : a < b;
+	});
+
+	ScratchVector<GridHit> hits;
+	// sweep along x: only edges whose x ranges overlap are tested
+	for (int a = 0; a < ne; a++) {
+		int i = order[a];
+		for (int b = a + 1; b < ne && minX[order[b]] <= maxX[i]; b++) {
+			int j = order[b];
+			if (maxY[j] < minY[i] || minY[j] > maxY[i])
+				continue;
+			GridPoint A = pts[edges.v0[i]], B = pts[edges.v1[i]];
+			GridPoint C = pts[edges.v0[j]], D = pts[edges.v1[j]];
+			long long rx = B.x - A.x, ry = B.y - A.y;
+			long long sx = D.x - C.x, sy = D.y - C.y;
+			long long den = cross(rx, ry, sx, sy);
+			if (den == 0)
+				continue;	// parallel; collinear overlaps are merged below
+			long long n1 = cross(C.x - A.x, C.y - A.y, sx, sy);
+			long long n2 = cross(C.x - A.x, C.y - A.y, rx, ry);
+			if (den < 0) {
+				den = -den;
+				n1 = -n1;
+				n2 = -n2;
+			}
+			if (n1 < 0 || n1 > den || n2 < 0 || n2 > den)
+				continue;
+			bool int1 = n1 > 0 && n1 < den;
+			bool int2 = n2 > 0 && n2 < den;
+			if (!int1 && !int2)
+				continue;	// the segments only share an endpoint
+
+			int point;
+			if (int1 && int2) {
+				double t = (double)n1 / den;
+				GridPoint p = { A.x + llround(rx * t), A.y + llround(ry * t) };
+				std::pair<GridIndex::iterator, bool> found =
+					index.insert(std::make_pair(gridKey(p), (int)pts.size()));
+				point = found.first->second;
+				if (found.second) {
+					pts.push_back(p);
+					vts.add((float)(p.x * step), (float)(p.y * step));
+				}
+			}
+			else if (int1)
+				point = n2 == 0 ? edges.v0[j] : edges.v1[j];
+			else
+				point = n1 == 0 ? edges.v0[i] : edges.v1[i];
+
+			GridPoint p = pts[point];
+			if (int1) {
+				GridHit h = { i, (p.x - A.x) * rx + (p.y - A.y) * ry, point };
+				hits.push_back(h);
+			}
+			if (int2) {
+				GridHit h = { j, (p.x - C.x) * sx + (p.y - C.y) * sy, point };
+				hits.push_back(h);
+			}
+		}
+	}
+	std::sort(hits.begin(), hits.end(), [](const GridHit &a, const GridHit &b) {
+		if (a.edge != b.edge) return a.edge < b.edge;
+		if (a.along != b.along) return a.along < b.along;
+		return a.vertex < b.vertex;
+	});
+
+	// same output order and orientation as splitAtCrossings()
+	ScratchEdgeArray out;
+	out.reserve(ne + hits.size());
+	size_t k = 0;
+	for (int e = 0; e < ne; e++) {
+		int prev = edges.v0[e];
+		for (; k <= hits.size(); k++) {
+			bool end = k == hits.size() || hits[k].edge != e;
+			int v = end ? edges.v1[e] : hits[k].vertex;
+			if (v != prev)
+				out.add(std::min(prev, v), std::max(prev, v), edges.angle[e], edges.type[e]);
+			prev = v;
+			if (end)
+				break;
+		}
+	}
+	edges.assign(out);
+
+	// overlaps as drawn, and those made where a rounded crossing point lands on another edge
+	mergeOverlaps(pts, edges, typeRank);
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <cmath>
+#include "soa.h"
+
+/*
+ * Integer snap-rounding mode.
+ *
+ * Coordinates are rounded to multiples of a grid step at load time and the
+ * geometry runs on the grid indices in 64-bit integers: crossings are exact
+ * rational tests with no tolerance, crossing points are rounded to the
+ * nearest grid point, and vertices are equal exactly when their grid
+ * indices are, which makes them hashable.
+ *
+ * The float coordinates are kept as the grid point times the step. With a
+ * power-of-two step (1/1024) they stay exact while the indices fit in the
+ * 24-bit float mantissa, i.e. up to 16384 units at 1/1024. Grid indices
+ * must stay below GRID_LIMIT so the cross products fit in 64 bits, which
+ * is 524288 units at 1/1024; snapVertices() checks it.
+ */
+
+const long long GRID_LIMIT = 1LL << 29;
+
+struct GridPoint {
+	long long x, y;
+};
+
+inline GridPoint toGrid(float x, float y, double step) {
+	GridPoint p = { llround(x / step), llround(y / step) };
+	return p;
+}
+
+// Rounds every vertex to the grid. Returns false, leaving the vertices as
+// they are, when a grid index would reach GRID_LIMIT.
+bool snapVertices(VertexArray &vts, double step);
+
+// Finds the crossings on the grid, splits the edges at them and merges the
+// collinear edges that overlap; typeRank[type] picks the type of a merged
+// piece, 0 wins.
+void splitSnapped(VertexArray &vts, EdgeArray &edges, double step, const unsigned char *typeRank);
+
+// Counterclockwise angle order of a and b around o, largest atan2 first.
+bool angleGreater(GridPoint o, GridPoint a, GridPoint b);
@@ -0,0 +1,176 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+/*
+ * Structure-of-arrays storage for the pattern geometry.
+ *
+ * Coordinates and edge fields live in separate arrays aligned for SIMD
+ * loads, so kernels can stream one field over many elements instead of
+ * copying Vertice/Edge objects around. Patterns are flat, so there is no z.
+ */
+
+const size_t SOA_ALIGN = 32;	// one AVX register
+
+template <class T, size_t Align = SOA_ALIGN>
+struct AlignedAllocator {
+	typedef T value_type;
+
+	template <class U>
+	struct rebind { typedef AlignedAllocator<U, Align> other; };
+
+	AlignedAllocator() {}
+	template <class U>
+	AlignedAllocator(const AlignedAllocator<U, Align> &) {}
+
+	T *allocate(size_t n) {
+		return (T *)::operator new(n * sizeof(T), std::align_val_t(Align));
+	}
+	void deallocate(T *p, size_t) {
+		::operator delete(p, std::align_val_t(Align));
+	}
+
+	template <class U>
+	bool operator==(const AlignedAllocator<U, Align> &) const { return true; }
+	template <class U>
+	bool operator!=(const AlignedAllocator<U, Align> &) const { return false; }
+};
+
+template <class T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
+template <template <class> class Vec>
+struct BasicVertexArray {
+	Vec<float> x, y;
+
+	size_t size() const { return x.size(); }
+	void clear() { x.clear(); y.clear(); }
+	void reserve(size_t n) { x.reserve(n); y.reserve(n); }
+
+	int add(float px, float py) {
+		x.push_back(px);
+		y.push_back(py);
+		return (int)x.size() - 1;
+	}
+
+	// Copies other in, reusing this array's capacity.
+	template <class Other>
+	void assign(const Other &other) {
+		x.assign(other.x.begin(), other.x.end());
+		y.assign(other.y.begin(), other.y.end());
+	}
+};
+
+typedef BasicVertexArray<AlignedVector> VertexArray;
+
+template <template <class> class Vec>
+struct BasicEdgeArray {
+	Vec<int> v0, v1;	// vertex indices
+	Vec<float> angle;
+	Vec<unsigned char> type;	// TYPE
+
+	size_t size() const { return v0.size(); }
+	void clear() { v0.clear(); v1.clear(); angle.clear(); type.clear(); }
+	void reserve(size_t n) { v0.reserve(n); v1.reserve(n); angle.reserve(n); type.reserve(n); }
+
+	int add(int a, int b, float ang, unsigned char t) {
+		v0.push_back(a);
+		v1.push_back(b);
+		angle.push_back(ang);
+		type.push_back(t);
+		return (int)v0.size() - 1;
+	}
+
+	template <class Other>
+	void assign(const Other &other) {
+		v0.assign(other.v0.begin(), other.v0.end());
+		v1.assign(other.v1.begin(), other.v1.end());
+		angle.assign(other.angle.begin(), other.angle.end());
+		type.assign(other.type.begin(), other.type.end());
+	}
+};
+
+typedef BasicEdgeArray<AlignedVector> EdgeArray;
+
+/*
+ * Vertex adjacency in compressed sparse row form: the neighbors of vertex v
+ * are ids[offsets[v]] up to ids[offsets[v + 1]], in edge order until sorted.
+ */
+struct NeighborArray {
+	AlignedVector<int> offsets, ids;
+
+	size_t size() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+	void clear() { offsets.clear(); ids.clear(); }
+	int degree(int v) const { return offsets[v + 1] - offsets[v]; }
+	int *begin(int v) { return ids.data() + offsets[v]; }
+	int *end(int v) { return ids.data() + offsets[v + 1]; }
+	const int *begin(int v) const { return ids.data() + offsets[v]; }
+	const int *end(int v) const { return ids.data() + offsets[v + 1]; }
+
+	// Two passes over the edges, one to count the degrees, one to fill the rows.
+	void build(int vertexCount, const EdgeArray &edges) {
+		int m = (int)edges.size();
+		offsets.assign(vertexCount + 1, 0);
+		for (int i = 0; i < m; i++) {
+			offsets[edges.v0[i] + 1]++;
+			offsets[edges.v1[i] + 1]++;
+		}
+		for (int v = 0; v < vertexCount; v++)
+			offsets[v + 1] += offsets[v];
+		ids.resize(2 * m);
+		// offsets[v] serves as the fill cursor of row v, ending at the row's end
+		for (int i = 0; i < m; i++) {
+			ids[offsets[edges.v0[i]]++] = edges.v1[i];
+			ids[offsets[edges.v1[i]]++] = edges.v0[i];
+		}
+		for (int v = vertexCount; v > 0; v--)
+			offsets[v] = offsets[v - 1];
+		offsets[0] = 0;
+	}
+};
+
+enum FACE_KIND {
+	FaceInterior,	// bounded face, negative orientation
+	FaceOuter,		// outside of a piece of the pattern that no face contains
+	FaceHole		// outside of a piece lying inside a face of another piece
+};
+
+/*
+ * Closed vertex cycles, one after another: the vertex ids of cycle f are
+ * vts[offsets[f]] up to vts[offsets[f + 1]].
+ */
+struct FaceArray {
+	AlignedVector<int> offsets, vts;
+	AlignedVector<double> area;	// twice the signed area, rounded
+	AlignedVector<signed char> orientation;	// exact sign of area
+	AlignedVector<unsigned char> kind;	// FACE_KIND
+	AlignedVector<int> parent;	// FaceHole: the interior face around it, otherwise -1
+
+	FaceArray() :offsets(1, 0) {}
+
+	size_t size() const { return offsets.size() - 1; }
+	void clear() {
+		offsets.assign(1, 0); vts.clear(); area.clear(); orientation.clear(); kind.clear(); parent.clear();
+	}
+	int length(int f) const { return offsets[f + 1] - offsets[f]; }
+	const int *begin(int f) const { return vts.data() + offsets[f]; }
+	const int *end(int f) const { return vts.data() + offsets[f + 1]; }
+};
+
+// Triangles as packed vertex id triples, three entries of vts per triangle.
+struct TriangleArray {
+	AlignedVector<uint32_t> vts;
+
+	size_t size() const { return vts.size() / 3; }
+	void clear() { vts.clear(); }
+	void reserve(size_t n) { vts.reserve(3 * n); }
+	const uint32_t *operator[](size_t t) const { return vts.data() + 3 * t; }
+
+	void add(uint32_t a, uint32_t b, uint32_t c) {
+		vts.push_back(a);
+		vts.push_back(b);
+		vts.push_back(c);
+	}
+};
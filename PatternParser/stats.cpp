@@ -0,0 +1,100 @@
+#include "stats.h"
+#include <cstring>
+#include <algorithm>
+
+using std::min;
+using std::max;
+
+const char *stageName(STAGE stage) {
+	static const char *names[] = {
+		"load", "dedupe", "intersections", "reorder", "neighbors", "faces", "triangulation"
+	};
+	return stage < STAGE_COUNT ? names[stage] : "unknown";
+}
+
+void ParseStats::clear() {
+	memset(stages, 0, sizeof(stages));
+	memset(subsystems, 0, sizeof(subsystems));
+	counterMode = PerfOff;
+	countersAvailable = 0;
+	bandwidth[0] = bandwidth[1] = 0;
+}
+
+double ParseStats::totalSeconds() const {
+	double total = 0.0;
+	for (int i = 0; i < STAGE_COUNT; i++)
+		total += stages[i].seconds;
+	return total;
+}
+
+size_t ParseStats::totalAllocs() const {
+	size_t total = 0;
+	for (int i = 0; i < STAGE_COUNT; i++)
+		total += stages[i].allocs;
+	return total;
+}
+
+size_t ParseStats::totalBytes() const {
+	size_t total = 0;
+	for (int i = 0; i < STAGE_COUNT; i++)
+		total += stages[i].bytes;
+	return total;
+}
+
+size_t ParseStats::peakBytes() const {
+	size_t peak = 0;
+	for (int i = 0; i < STAGE_COUNT; i++)
+		peak = max(peak, stages[i].peakBytes);
+	return peak;
+}
+
+SubsystemAccounting::SubsystemAccounting(ParseStats &s)
+	:stats(s) {
+	for (int i = 0; i < SUBSYSTEM_COUNT; i++) {
+		memResetPeak((SUBSYSTEM)i);
+		start[i] = memSubsystem((SUBSYSTEM)i);
+	}
+}
+
+SubsystemAccounting::~SubsystemAccounting() {
+	for (int i = 0; i < SUBSYSTEM_COUNT; i++) {
+		MemCounters end = memSubsystem((SUBSYSTEM)i);
+		MemCounters &out = stats.subsystems[i];
+		out.allocs += end.allocs - start[i].allocs;
+		out.bytes += end.bytes - start[i].bytes;
+		out.liveBytes = end.liveBytes;
+		out.peakBytes = max(out.peakBytes, end.peakBytes - min(end.peakBytes, start[i].liveBytes));
+	}
+}
+
+StageTimer::StageTimer(ParseStats &stats, STAGE s, size_t elements)
+	:stage(stats.stages[s]), counters(NULL) {
+	stage.elements += elements;
+	stage.calls++;
+	if (perfCountersEnabled()) {
+		counters = &PerfCounters::forThread();
+		stats.counterMode = counters->getMode();
+		stats.countersAvailable = 0;
+		for (int c = 0; c < PERF_COUNTER_COUNT; c++)
+			stats.countersAvailable |= counters->has((PERF_COUNTER)c) << c;
+		counters->read(counterStart);
+	}
+	memResetPeak();
+	memStart = memTotal();
+	start = std::chrono::steady_clock::now();
+}
+
+StageTimer::~StageTimer() {
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	stage.seconds += elapsed.count();
+	MemCounters memEnd = memTotal();
+	stage.allocs += memEnd.allocs - memStart.allocs;
+	stage.bytes += memEnd.bytes - memStart.bytes;
+	stage.peakBytes = max(stage.peakBytes, memEnd.peakBytes - min(memEnd.peakBytes, memStart.liveBytes));
+	if (counters) {
+		PerfSample end;
+		counters->read(end);
+		for (int c = 0; c < PERF_COUNTER_COUNT; c++)
+			stage.counters[c] += end.values[c] - counterStart.values[c];
+	}
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+
+#include "perfcounters.h"
+#include "memstats.h"
+
+// Pipeline stages of Pattern::parse(), in execution order.
+enum STAGE {
+	StageLoad, StageDedupe, StageIntersect, StageReorder, StageNeighbors, StageFaces, StageTriangulate, STAGE_COUNT
+};
+
+const char *stageName(STAGE stage);
+
+struct StageStats {
+	double seconds;		// wall time spent in the stage
+	size_t elements;	// number of elements the stage worked on
+	size_t allocs;		// heap allocations made during the stage
+	size_t bytes;		// bytes those allocations requested
+	size_t peakBytes;	// heap high-water mark above the stage's starting point
+	size_t calls;		// times the stage ran during one parse
+	unsigned long long counters[PERF_COUNTER_COUNT];	// see perfcounters.h
+};
+
+struct ParseStats {
+	StageStats stages[STAGE_COUNT];
+	PERF_MODE counterMode;	// which counters[] are filled in
+	unsigned countersAvailable;	// bit per PERF_COUNTER
+	MemCounters subsystems[SUBSYSTEM_COUNT];	// heap use of the whole parse by subsystem
+	int bandwidth[2];	// largest edge id difference before and after StageReorder, 0 if it did not run
+
+	ParseStats() { clear(); }
+	void clear();
+	double totalSeconds() const;
+	size_t totalAllocs() const;
+	size_t totalBytes() const;
+	size_t peakBytes() const;
+};
+
+/*
+ * Heap numbers come from memstats.h and stay zero unless the executable
+ * links the allocation hooks.
+ */
+
+// Records the per-subsystem heap use of its own lifetime into stats.subsystems.
+class SubsystemAccounting {
+private:
+	ParseStats &stats;
+	MemCounters start[SUBSYSTEM_COUNT];
+
+public:
+	SubsystemAccounting(ParseStats &s);
+	~SubsystemAccounting();
+};
+
+/*
+ * Adds the wall time and heap use of its own lifetime to one stage, and the
+ * performance counter deltas when perfCountersEnabled().
+ */
+class StageTimer {
+private:
+	StageStats &stage;
+	std::chrono::steady_clock::time_point start;
+	MemCounters memStart;
+	PerfCounters *counters;
+	PerfSample counterStart;
+
+public:
+	StageTimer(ParseStats &stats, STAGE s, size_t elements = 0);
+	~StageTimer();
+
+	void addElements(size_t n) { stage.elements += n; }
+};
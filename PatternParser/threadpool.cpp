@@ -0,0 +1,131 @@
+#include "threadpool.h"
+#include "memstats.h"
+#include <map>
+
+struct ThreadPool::Batch {
+	const std::function<void(int)> *fn;
+	SUBSYSTEM subsystem;
+	std::atomic<int> remaining;
+	std::mutex lock;
+	std::condition_variable done;
+};
+
+ThreadPool::ThreadPool(int threads)
+	:pending(0), stopping(false) {
+	if (threads <= 0)
+		threads = (int)std::thread::hardware_concurrency();
+	if (threads <= 0)
+		threads = 1;
+	// queue 0 is served by the threads calling parallelFor()
+	for (int i = 0; i < threads; i++)
+		queues.push_back(std::unique_ptr<Queue>(new Queue));
+	for (int i = 1; i < threads; i++)
+		workers.push_back(std::thread(&ThreadPool::work, this, i));
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> guard(sleepLock);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (std::thread &t : workers)
+		t.join();
+}
+
+bool ThreadPool::take(int self, Task &task) {
+	int n = size();
+	for (int k = 0; k < n; k++) {
+		int q = (self + k) % n;
+		std::lock_guard<std::mutex> guard(queues[q]->lock);
+		std::deque<Task> &tasks = queues[q]->tasks;
+		if (tasks.empty())
+			continue;
+		if (k == 0) {
+			task = tasks.back();
+			tasks.pop_back();
+		}
+		else {
+			task = tasks.front();
+			tasks.pop_front();
+		}
+		pending--;
+		return true;
+	}
+	return false;
+}
+
+void ThreadPool::run(const Task &task) {
+	Batch *batch = task.batch;
+	{
+		SubsystemScope scope(batch->subsystem);
+		(*batch->fn)(task.index);
+	}
+	// decrement under the lock so the caller cannot free the batch before we let go
+	std::lock_guard<std::mutex> guard(batch->lock);
+	if (--batch->remaining == 0)
+		batch->done.notify_all();
+}
+
+void ThreadPool::work(int self) {
+	Task task;
+	for (;;) {
+		if (take(self, task)) {
+			run(task);
+			continue;
+		}
+		std::unique_lock<std::mutex> lk(sleepLock);
+		wake.wait(lk, [this] { return stopping || pending > 0; });
+		if (stopping && pending == 0)
+			return;
+	}
+}
+
+void ThreadPool::parallelFor(int count, const std::function<void(int)> &fn) {
+	if (count <= 0)
+		return;
+	if (size() == 1 || count == 1) {
+		for (int i = 0; i < count; i++)
+			fn(i);
+		return;
+	}
+
+	Batch batch;
+	batch.fn = &fn;
+	batch.subsystem = currentSubsystem();
+	batch.remaining = count;
+
+	pending += count;
+	int n = size();
+	for (int q = 0; q < n; q++) {
+		std::lock_guard<std::mutex> guard(queues[q]->lock);
+		for (int i = q; i < count; i += n) {
+			Task task = { &batch, i };
+			queues[q]->tasks.push_back(task);
+		}
+	}
+	{
+		std::lock_guard<std::mutex> guard(sleepLock);
+	}
+	wake.notify_all();
+
+	Task task;
+	while (batch.remaining > 0 && take(0, task))
+		run(task);
+
+	std::unique_lock<std::mutex> lk(batch.lock);
+	batch.done.wait(lk, [&batch] { return batch.remaining == 0; });
+}
+
+ThreadPool &ThreadPool::shared(int threads) {
+	// one pool per thread count, never freed (see threadpool.h)
+	static std::mutex lock;
+	static std::map<int, std::unique_ptr<ThreadPool>> pools;
+	if (threads <= 0)
+		threads = (int)std::thread::hardware_concurrency();
+	std::lock_guard<std::mutex> guard(lock);
+	std::unique_ptr<ThreadPool> &pool = pools[threads];
+	if (!pool)
+		pool.reset(new ThreadPool(threads));
+	return *pool;
+}
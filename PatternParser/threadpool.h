@@ -0,0 +1,58 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Work-stealing thread pool.
+ *
+ * Every worker owns a deque: it takes its own work from the back and, when
+ * that runs dry, steals from the front of the others. parallelFor() deals
+ * the indices out round-robin, so uneven tasks (dense tiles next to empty
+ * ones) even out through stealing. The calling thread helps until its batch
+ * is done, and tasks inherit its heap accounting subsystem.
+ */
+
+class ThreadPool {
+private:
+	struct Batch;
+	struct Task {
+		Batch *batch;
+		int index;
+	};
+	struct Queue {
+		std::mutex lock;
+		std::deque<Task> tasks;
+	};
+
+	std::vector<std::unique_ptr<Queue>> queues;
+	std::vector<std::thread> workers;
+	std::mutex sleepLock;
+	std::condition_variable wake;
+	std::atomic<int> pending;	// tasks queued and not yet taken
+	bool stopping;
+
+	bool take(int self, Task &task);
+	void run(const Task &task);
+	void work(int self);
+
+public:
+	explicit ThreadPool(int threads);	// 0 = hardware concurrency
+	~ThreadPool();
+
+	int size() const { return (int)queues.size(); }
+
+	// Runs fn(0) .. fn(count - 1) on the pool and returns when all are done.
+	void parallelFor(int count, const std::function<void(int)> &fn);
+
+	// Pool shared by the parser for the given thread count. Each distinct
+	// count gets its own pool on first use, and that pool keeps its threads
+	// until the process exits: a program that asks for k different counts
+	// holds k pools. Callers are expected to use one or two counts.
+	static ThreadPool &shared(int threads);
+};
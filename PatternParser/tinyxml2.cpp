@@ -2078,6 +2078,14 @@ void XMLDocument::Clear()
 }
 
 
+void XMLDocument::ReservePools( int elements, int attributes, int texts )
+{
+    _elementPool.Reserve( elements );
+    _attributePool.Reserve( attributes );
+    _textPool.Reserve( texts );
+}
+
+
 void XMLDocument::DeepCopy(XMLDocument* target) const
 {
 	TIXMLASSERT(target);
@@ -346,7 +346,7 @@ template< int ITEM_SIZE >
 class MemPoolT : public MemPool
 {
 public:
-    MemPoolT() : _blockPtrs(), _root(0), _currentAllocs(0), _nAllocs(0), _maxAllocs(0), _nUntracked(0)	{}
+    MemPoolT() : _blockPtrs(), _slabPtrs(), _root(0), _capacity(0), _currentAllocs(0), _nAllocs(0), _maxAllocs(0), _nUntracked(0)	{}
     ~MemPoolT() {
         MemPoolT< ITEM_SIZE >::Clear();
     }
@@ -357,7 +357,12 @@ public:
             Block* lastBlock = _blockPtrs.Pop();
             delete lastBlock;
         }
+        while( !_slabPtrs.Empty()) {
+            Item* lastSlab = _slabPtrs.Pop();
+            delete [] lastSlab;
+        }
         _root = 0;
+        _capacity = 0;
         _currentAllocs = 0;
         _nAllocs = 0;
         _maxAllocs = 0;
@@ -370,6 +375,26 @@ public:
     int CurrentAllocs() const		{
         return _currentAllocs;
     }
+    int Capacity() const {
+        return _capacity;
+    }
+
+    // Grows the pool to at least count items with a single allocation,
+    // instead of one block at a time as Alloc() runs out.
+    void Reserve( int count ) {
+        if ( count <= _capacity ) {
+            return;
+        }
+        const int n = count - _capacity;
+        Item* slab = new Item[n];
+        _slabPtrs.Push( slab );
+        for( int i = 0; i < n - 1; ++i ) {
+            slab[i].next = &(slab[i + 1]);
+        }
+        slab[n - 1].next = _root;
+        _root = slab;
+        _capacity += n;
+    }
 
     virtual void* Alloc() {
         if ( !_root ) {
@@ -383,6 +408,7 @@ public:
             }
             blockItems[ITEMS_PER_BLOCK - 1].next = 0;
             _root = blockItems;
+            _capacity += ITEMS_PER_BLOCK;
         }
         Item* const result = _root;
         TIXMLASSERT( result != 0 );
@@ -448,7 +474,9 @@ private:
         Item items[ITEMS_PER_BLOCK];
     };
     DynArray< Block*, 10 > _blockPtrs;
+    DynArray< Item*, 4 > _slabPtrs;	// from Reserve()
     Item* _root;
+    int _capacity;		// items in blocks and slabs
 
     int _currentAllocs;
     int _nAllocs;
@@ -1812,7 +1840,10 @@ public:
     void DeleteNode( XMLNode* node );
 
     void ClearError() {
-        SetError(XML_SUCCESS, 0, 0);
+        // no message to format, so a reused document clears without allocating
+        _errorID = XML_SUCCESS;
+        _errorLineNum = 0;
+        _errorStr.Reset();
     }
 
     /// Return true if there was an error parsing the document.
@@ -1843,6 +1874,18 @@ public:
     /// Clear the document, resetting it to the initial state.
     void Clear();
 
+    /**
+    	Grows the node pools to hold at least this many elements, attributes
+    	and texts, e.g. ahead of loading a file of known size. The pools keep
+    	their memory across Clear(), so a reused document only grows them once.
+    */
+    void ReservePools( int elements, int attributes, int texts );
+
+    /// Elements, attributes and texts currently allocated from the pools.
+    int PooledElements() const		{ return _elementPool.CurrentAllocs(); }
+    int PooledAttributes() const	{ return _attributePool.CurrentAllocs(); }
+    int PooledTexts() const			{ return _textPool.CurrentAllocs(); }
+
 	/**
 		Copies this document to a target document.
 		The target will be completely cleared before the copy.
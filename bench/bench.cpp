@@ -0,0 +1,591 @@
+/*
+ * Per-stage benchmark over the bundled assets corpus.
+ *
+ * Every SVG under the assets directory is parsed --repetitions times and the
+ * per-stage numbers recorded by Pattern::stats are reported per file:
+ * median wall time, time per element and heap allocations, bytes and peak.
+ * Heap numbers come from the allocation hooks (allochooks.cpp) linked into
+ * this executable; the JSON output also splits them by subsystem.
+ *
+ * --synthetic KIND:N1,N2,... runs generated tessellations (see generator.h)
+ * at each size instead, and fits how every stage scales with the element
+ * count so accidental quadratic behaviour shows up as an exponent near 2.
+ *
+ * --counters adds hardware performance counters (or their software fallback,
+ * see perfcounters.h) sampled around every stage.
+ *
+ * --simd scalar|sse|avx2 caps the intersection kernel (see intersect.h) to
+ * compare instruction sets on the same machine.
+ *
+ * --threads N finds intersections with the tiled search and walks the faces
+ * in parallel on N threads (see ParseOptions); 0 uses one thread per core.
+ *
+ * --snap STEP runs the integer snap-rounding mode on a grid of STEP units
+ * (see snap.h), e.g. 0.0009765625 for 1/1024.
+ *
+ * --angle-precision float|double picks the scalar policy (see geom.h)
+ * of the neighbour angle sort and the quad diagonal choice; intersections
+ * stay in float.
+ *
+ * --order sorted|morton|rcm renumbers the vertices before the topology stages
+ * (see reorder.h); run with --counters to compare their cache misses. The
+ * edge bandwidth before and after is listed below the stage table.
+ *
+ * --reuse parses the whole batch with one Pattern, reset() to every input in
+ * turn, and lists the allocations of its first parse against the average
+ * over the rest, which falls to near zero once the containers have grown.
+ *
+ *   pattern_bench [--assets DIR] [--filter SUBSTR] [--repetitions N]
+ *                 [--synthetic KIND:N1,N2,...] [--counters] [--simd LEVEL]
+ *                 [--threads N] [--snap STEP] [--angle-precision P] [--order O]
+ *                 [--reuse] [--format console|json|csv] [--out FILE]
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <thread>
+
+#include "pattern.h"
+#include "generator.h"
+#include "intersect.h"
+#include "threadpool.h"
+
+namespace fs = std::filesystem;
+
+struct Options {
+	string assets;
+	string filter;
+	string format;
+	string out;
+	vector<string> synthetic;
+	int repetitions;
+	bool counters;
+	bool reuse;
+	SIMD_LEVEL simd;
+	ParseOptions parse;
+	Options() :format("console"), repetitions(5), counters(false), reuse(false), simd(simdSupported()) {}
+};
+
+// One row of the report: a stage of one file, aggregated over repetitions.
+struct Result {
+	string group;	// synthetic runs of one kind share a group
+	string file;
+	string stage;
+	size_t elements;
+	double medianNs;
+	double minNs;
+	double p95Ns;
+	double allocs;
+	double bytes;
+	double peakBytes;
+	vector<double> samples;	// ns per repetition, for pattern_compare
+	PERF_MODE counterMode;
+	unsigned countersAvailable;
+	double counters[PERF_COUNTER_COUNT];	// medians
+	MemCounters subsystems[SUBSYSTEM_COUNT];	// "total" rows only, last repetition
+	int bandwidth[2];	// "reorder" rows only, before and after
+};
+
+static double median(vector<double> v) {
+	if (v.empty()) return 0.0;
+	sort(v.begin(), v.end());
+	size_t n = v.size();
+	return n % 2 ? v[n / 2] : 0.5 * (v[n / 2 - 1] + v[n / 2]);
+}
+
+// Nearest-rank percentile, p in [0, 100].
+static double percentile(vector<double> v, double p) {
+	if (v.empty()) return 0.0;
+	sort(v.begin(), v.end());
+	size_t rank = (size_t)ceil(p / 100.0 * v.size());
+	return v[rank ? rank - 1 : 0];
+}
+
+static double nsPerElement(const Result &r) {
+	return r.elements ? r.medianNs / r.elements : 0.0;
+}
+
+// Least-squares slope of log(time) over log(elements), i.e. k in time ~ n^k.
+struct Scaling {
+	string group;
+	string stage;
+	double exponent;
+};
+
+static vector<Scaling> fitScaling(const vector<Result> &results) {
+	vector<Scaling> fits;
+	for (size_t i = 0; i < results.size(); i++) {
+		const Result &first = results[i];
+		if (first.group.empty()) continue;
+		bool seen = false;
+		for (const Scaling &f : fits)
+			seen = seen || (f.group == first.group && f.stage == first.stage);
+		if (seen) continue;
+
+		double sx = 0, sy = 0, sxx = 0, sxy = 0;
+		int n = 0;
+		for (size_t j = i; j < results.size(); j++) {
+			const Result &r = results[j];
+			if (r.group != first.group || r.stage != first.stage) continue;
+			if (r.elements == 0 || r.medianNs <= 0) continue;
+			double x = log((double)r.elements), y = log(r.medianNs);
+			sx += x; sy += y; sxx += x * x; sxy += x * y;
+			n++;
+		}
+		double denom = n * sxx - sx * sx;
+		if (n < 2 || denom <= 0) continue;
+		fits.push_back(Scaling{ first.group, first.stage, (n * sxy - sx * sy) / denom });
+	}
+	return fits;
+}
+
+static string jsonEscape(const string &s) {
+	string ret;
+	for (char c : s) {
+		if (c == '"' || c == '\\') ret += '\\';
+		ret += c;
+	}
+	return ret;
+}
+
+static const char *precisionNames[] = { "float", "double" };
+static const char *orderNames[] = { "sorted", "morton", "rcm" };
+
+static void usage() {
+	cout << "usage: pattern_bench [--assets DIR] [--filter SUBSTR] [--repetitions N]\n"
+		<< "                     [--synthetic KIND:N1,N2,...] [--counters] [--simd scalar|sse|avx2]\n"
+		<< "                     [--threads N] [--snap STEP] [--angle-precision float|double]\n"
+		<< "                     [--order sorted|morton|rcm] [--reuse]\n"
+		<< "                     [--format console|json|csv] [--out FILE]\n"
+		<< "       KIND is one of miura, twist, resch, random\n";
+}
+
+static bool parseArgs(int argc, char **argv, Options &opt) {
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--assets" && hasValue) opt.assets = argv[++i];
+		else if (arg == "--filter" && hasValue) opt.filter = argv[++i];
+		else if (arg == "--repetitions" && hasValue) opt.repetitions = atoi(argv[++i]);
+		else if (arg == "--format" && hasValue) opt.format = argv[++i];
+		else if (arg == "--out" && hasValue) opt.out = argv[++i];
+		else if (arg == "--synthetic" && hasValue) opt.synthetic.push_back(argv[++i]);
+		else if (arg == "--counters") opt.counters = true;
+		else if (arg == "--reuse") opt.reuse = true;
+		else if (arg == "--threads" && hasValue) {
+			opt.parse.intersect = IntersectTiled;
+			opt.parse.faces = FacesParallel;
+			opt.parse.threads = atoi(argv[++i]);
+		}
+		else if (arg == "--snap" && hasValue) {
+			opt.parse.snapGrid = atof(argv[++i]);
+			if (opt.parse.snapGrid <= 0) return false;
+		}
+		else if (arg == "--angle-precision" && hasValue) {
+			string name = argv[++i];
+			if (name == "float") opt.parse.anglePrecision = PrecisionFloat;
+			else if (name == "double") opt.parse.anglePrecision = PrecisionDouble;
+			else return false;
+		}
+		else if (arg == "--order" && hasValue) {
+			string name = argv[++i];
+			if (name == "sorted") opt.parse.vertexOrder = OrderSorted;
+			else if (name == "morton") opt.parse.vertexOrder = OrderMorton;
+			else if (name == "rcm") opt.parse.vertexOrder = OrderRCM;
+			else return false;
+		}
+		else if (arg == "--simd" && hasValue) {
+			if (!simdLevelFromName(argv[++i], opt.simd)) return false;
+		}
+		else return false;
+	}
+	if (opt.repetitions < 1) return false;
+	return opt.format == "console" || opt.format == "json" || opt.format == "csv";
+}
+
+static string findAssets(const string &hint) {
+	if (!hint.empty()) return hint;
+	const char *candidates[] = { "assets", "../assets", "../../assets" };
+	for (const char *c : candidates) {
+		if (fs::is_directory(c)) return c;
+	}
+	return "assets";
+}
+
+static vector<fs::path> collectFiles(const string &root, const string &filter) {
+	vector<fs::path> files;
+	for (const fs::directory_entry &entry : fs::recursive_directory_iterator(root)) {
+		if (!entry.is_regular_file() || entry.path().extension() != ".svg") continue;
+		if (!filter.empty() && entry.path().string().find(filter) == string::npos) continue;
+		files.push_back(entry.path());
+	}
+	sort(files.begin(), files.end());
+	return files;
+}
+
+// Parses "KIND:N1,N2,..." into a tessellation kind and its sizes.
+static bool parseSynthetic(const string &spec, TESSELLATION &kind, vector<int> &sizes) {
+	size_t colon = spec.find(':');
+	if (colon == string::npos || !tessellationFromName(spec.substr(0, colon), kind))
+		return false;
+	stringstream ss(spec.substr(colon + 1));
+	string item;
+	while (getline(ss, item, ',')) {
+		int n = atoi(item.c_str());
+		if (n < 1) return false;
+		sizes.push_back(n);
+	}
+	return !sizes.empty();
+}
+
+// Allocations of every parse made with the reused Pattern, in order.
+struct Batch {
+	vector<double> allocs;
+	vector<double> bytes;
+};
+
+/*
+ * Runs one input, either an SVG file or in-memory creases when creases != NULL.
+ * With reused != NULL every repetition resets that Pattern instead of
+ * constructing one, and its allocations are appended to batch.
+ */
+static void benchCase(const string &path, const vector<Edge> *creases, const string &group,
+	const string &name, const Options &opt, Pattern *reused, Batch &batch, vector<Result> &results) {
+	int repetitions = opt.repetitions;
+	vector<double> times[STAGE_COUNT + 1];
+	vector<double> allocs[STAGE_COUNT + 1];
+	vector<double> bytes[STAGE_COUNT + 1];
+	vector<double> peaks[STAGE_COUNT + 1];
+	vector<double> counters[STAGE_COUNT + 1][PERF_COUNTER_COUNT];
+	ParseStats last;
+	for (int r = 0; r < repetitions; r++) {
+		unique_ptr<Pattern> fresh;
+		if (!reused)
+			fresh.reset(creases ? new Pattern(*creases, name) : new Pattern(path));
+		else if (creases)
+			reused->reset(*creases, name);
+		else
+			reused->reset(path);
+		Pattern &p = reused ? *reused : *fresh;
+		p.options = opt.parse;
+		p.parse();
+		if (reused) {
+			batch.allocs.push_back((double)p.stats.totalAllocs());
+			batch.bytes.push_back((double)p.stats.totalBytes());
+		}
+		for (int s = 0; s < STAGE_COUNT; s++) {
+			times[s].push_back(p.stats.stages[s].seconds * 1e9);
+			allocs[s].push_back((double)p.stats.stages[s].allocs);
+			bytes[s].push_back((double)p.stats.stages[s].bytes);
+			peaks[s].push_back((double)p.stats.stages[s].peakBytes);
+		}
+		times[STAGE_COUNT].push_back(p.stats.totalSeconds() * 1e9);
+		allocs[STAGE_COUNT].push_back((double)p.stats.totalAllocs());
+		bytes[STAGE_COUNT].push_back((double)p.stats.totalBytes());
+		peaks[STAGE_COUNT].push_back((double)p.stats.peakBytes());
+		for (int c = 0; c < PERF_COUNTER_COUNT; c++) {
+			double total = 0;
+			for (int s = 0; s < STAGE_COUNT; s++) {
+				counters[s][c].push_back((double)p.stats.stages[s].counters[c]);
+				total += p.stats.stages[s].counters[c];
+			}
+			counters[STAGE_COUNT][c].push_back(total);
+		}
+		last = p.stats;
+	}
+
+	for (int s = 0; s <= STAGE_COUNT; s++) {
+		Result r;
+		r.group = group;
+		r.file = name;
+		r.stage = s < STAGE_COUNT ? stageName((STAGE)s) : "total";
+		r.elements = s < STAGE_COUNT ? last.stages[s].elements : last.stages[StageLoad].elements;
+		r.medianNs = median(times[s]);
+		r.minNs = *min_element(times[s].begin(), times[s].end());
+		r.p95Ns = percentile(times[s], 95.0);
+		r.allocs = median(allocs[s]);
+		r.bytes = median(bytes[s]);
+		r.peakBytes = median(peaks[s]);
+		r.samples = times[s];
+		r.counterMode = last.counterMode;
+		r.countersAvailable = last.countersAvailable;
+		for (int c = 0; c < PERF_COUNTER_COUNT; c++)
+			r.counters[c] = median(counters[s][c]);
+		memset(r.subsystems, 0, sizeof(r.subsystems));
+		if (s == STAGE_COUNT)
+			memcpy(r.subsystems, last.subsystems, sizeof(r.subsystems));
+		r.bandwidth[0] = s == StageReorder ? last.bandwidth[0] : 0;
+		r.bandwidth[1] = s == StageReorder ? last.bandwidth[1] : 0;
+		results.push_back(r);
+	}
+}
+
+static bool hasCounter(const Result &r, PERF_COUNTER c) {
+	return (r.countersAvailable >> c) & 1;
+}
+
+// Counter columns appended to a console row; empty when counters are off.
+static string counterColumns(const Result &r) {
+	char buf[160];
+	if (r.counterMode == PerfHardware) {
+		double ipc = r.counters[PerfCycles] > 0 ? r.counters[PerfInstructions] / r.counters[PerfCycles] : 0.0;
+		snprintf(buf, sizeof(buf), " %12.0f %6.2f", r.counters[PerfCycles], ipc);
+		string cols = buf;
+		PERF_COUNTER misses[] = { PerfL1DMisses, PerfLLCMisses, PerfBranchMisses };
+		for (PERF_COUNTER c : misses) {
+			if (hasCounter(r, c)) snprintf(buf, sizeof(buf), " %10.0f", r.counters[c]);
+			else snprintf(buf, sizeof(buf), " %10s", "n/a");
+			cols += buf;
+		}
+		return cols;
+	}
+	if (r.counterMode == PerfSoftware) {
+		snprintf(buf, sizeof(buf), " %9.3f ms %8.0f %8.0f", r.counters[PerfCPUTimeNs] / 1e6,
+			r.counters[PerfPageFaults], r.counters[PerfContextSwitches]);
+		return buf;
+	}
+	return "";
+}
+
+static string counterHeader(PERF_MODE mode) {
+	char buf[160];
+	if (mode == PerfHardware)
+		snprintf(buf, sizeof(buf), " %12s %6s %10s %10s %10s", "Cycles", "IPC", "L1D-miss", "LLC-miss", "Br-miss");
+	else if (mode == PerfSoftware)
+		snprintf(buf, sizeof(buf), " %12s %8s %8s", "CPU", "Faults", "CtxSw");
+	else
+		buf[0] = 0;
+	return buf;
+}
+
+// Mean of v from index first on.
+static double meanFrom(const vector<double> &v, size_t first) {
+	if (v.size() <= first) return 0.0;
+	double total = 0;
+	for (size_t i = first; i < v.size(); i++)
+		total += v[i];
+	return total / (v.size() - first);
+}
+
+static void reportConsole(ostream &out, const vector<Result> &results, const vector<Scaling> &fits,
+	const Batch &batch, const Options &opt) {
+	char line[256];
+	PERF_MODE mode = results.empty() ? PerfOff : results[0].counterMode;
+	string header = counterHeader(mode);
+	string rule(122 + header.size(), '-');
+	out << "Run on (" << thread::hardware_concurrency() << " X CPU), "
+		<< opt.repetitions << " repetitions, median reported, " << simdLevelName(simdLevel()) << " kernel";
+	if (opt.parse.intersect == IntersectTiled)
+		out << ", tiled intersections and parallel faces on " << ThreadPool::shared(opt.parse.threads).size() << " threads";
+	if (opt.parse.snapGrid > 0)
+		out << ", snapped to " << opt.parse.snapGrid;
+	if (opt.parse.anglePrecision != PrecisionFloat)
+		out << ", " << precisionNames[opt.parse.anglePrecision] << " angle sort";
+	if (opt.parse.vertexOrder != OrderSorted)
+		out << ", " << orderNames[opt.parse.vertexOrder] << " vertex order";
+	if (opt.reuse)
+		out << ", one Pattern reused";
+	if (opt.counters)
+		out << (mode == PerfHardware ? ", hardware counters" : mode == PerfSoftware ? ", software counters (no PMU access)" : ", no counters available");
+	out << '\n' << rule << '\n';
+	snprintf(line, sizeof(line), "%-60s %12s %10s %12s %10s %10s %10s", "Benchmark", "Time", "Elements", "Time/elem", "Allocs", "KiB", "Peak KiB");
+	out << line << header << '\n' << rule << '\n';
+	for (const Result &r : results) {
+		string name = r.file + "/" + r.stage;
+		snprintf(line, sizeof(line), "%-60s %9.3f ms %10zu %9.1f ns %10.0f %10.1f %10.1f",
+			name.c_str(), r.medianNs / 1e6, r.elements, nsPerElement(r), r.allocs,
+			r.bytes / 1024.0, r.peakBytes / 1024.0);
+		out << line << counterColumns(r) << '\n';
+	}
+	if (opt.parse.vertexOrder != OrderSorted) {
+		out << '\n' << "Bandwidth (largest edge id difference)\n" << rule << '\n';
+		for (const Result &r : results) {
+			if (r.stage != stageName(StageReorder)) continue;
+			snprintf(line, sizeof(line), "%-60s %10d -> %d", r.file.c_str(), r.bandwidth[0], r.bandwidth[1]);
+			out << line << '\n';
+		}
+	}
+	if (opt.reuse && !batch.allocs.empty()) {
+		out << '\n' << "Batch (" << batch.allocs.size() << " parses with one Pattern)\n" << rule << '\n';
+		snprintf(line, sizeof(line), "%-60s %10.0f allocs %10.1f KiB", "first parse", batch.allocs[0], batch.bytes[0] / 1024.0);
+		out << line << '\n';
+		snprintf(line, sizeof(line), "%-60s %10.1f allocs %10.1f KiB", "later parses, mean", meanFrom(batch.allocs, 1),
+			meanFrom(batch.bytes, 1) / 1024.0);
+		out << line << '\n';
+		snprintf(line, sizeof(line), "%-60s %10.1f allocs", "amortized over the batch", meanFrom(batch.allocs, 0));
+		out << line << '\n';
+	}
+	if (fits.empty()) return;
+
+	out << '\n' << "Scaling (time ~ elements^k)\n" << rule << '\n';
+	for (const Scaling &f : fits) {
+		snprintf(line, sizeof(line), "%-60s k = %5.2f%s", (f.group + "/" + f.stage).c_str(),
+			f.exponent, f.exponent > 1.5 ? "  superlinear" : "");
+		out << line << '\n';
+	}
+}
+
+static void reportCSV(ostream &out, const vector<Result> &results) {
+	out << "file,stage,elements,median_ns,min_ns,p95_ns,ns_per_element,allocs,bytes,peak_bytes";
+	for (int c = 0; c < PERF_COUNTER_COUNT; c++)
+		out << ',' << perfCounterName((PERF_COUNTER)c);
+	out << '\n';
+	for (const Result &r : results) {
+		out << '"' << r.file << "\"," << r.stage << ',' << r.elements << ','
+			<< r.medianNs << ',' << r.minNs << ',' << r.p95Ns << ',' << nsPerElement(r) << ',' << r.allocs
+			<< ',' << r.bytes << ',' << r.peakBytes;
+		for (int c = 0; c < PERF_COUNTER_COUNT; c++) {
+			out << ',';
+			if (hasCounter(r, (PERF_COUNTER)c)) out << r.counters[c];
+		}
+		out << '\n';
+	}
+}
+
+static void reportJSON(ostream &out, const vector<Result> &results, const vector<Scaling> &fits,
+	const Batch &batch, const Options &opt) {
+	char date[64];
+	time_t now = time(NULL);
+	strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+
+	out.precision(10);
+	out << "{\n  \"context\": {\n"
+		<< "    \"date\": \"" << date << "\",\n"
+		<< "    \"num_cpus\": " << thread::hardware_concurrency() << ",\n"
+		<< "    \"repetitions\": " << opt.repetitions << ",\n"
+		<< "    \"simd\": \"" << simdLevelName(simdLevel()) << "\",\n"
+		<< "    \"intersect_threads\": " << (opt.parse.intersect == IntersectTiled ? ThreadPool::shared(opt.parse.threads).size() : 0) << ",\n"
+		<< "    \"face_threads\": " << (opt.parse.faces == FacesParallel ? ThreadPool::shared(opt.parse.threads).size() : 0) << ",\n"
+		<< "    \"snap_grid\": " << opt.parse.snapGrid << ",\n"
+		<< "    \"angle_precision\": \"" << precisionNames[opt.parse.anglePrecision] << "\",\n"
+		<< "    \"vertex_order\": \"" << orderNames[opt.parse.vertexOrder] << "\",\n"
+		<< "    \"reuse\": " << (opt.reuse ? "true" : "false") << ",\n"
+#ifdef NDEBUG
+		<< "    \"library_build_type\": \"release\"\n"
+#else
+		<< "    \"library_build_type\": \"debug\"\n"
+#endif
+		<< "  },\n  \"benchmarks\": [";
+	for (size_t i = 0; i < results.size(); i++) {
+		const Result &r = results[i];
+		out << (i ? "," : "") << "\n    {"
+			<< "\"name\": \"" << jsonEscape(r.file + "/" + r.stage) << "\", "
+			<< "\"file\": \"" << jsonEscape(r.file) << "\", "
+			<< "\"stage\": \"" << r.stage << "\", "
+			<< "\"elements\": " << r.elements << ", "
+			<< "\"real_time\": " << r.medianNs << ", "
+			<< "\"min_time\": " << r.minNs << ", "
+			<< "\"p95_time\": " << r.p95Ns << ", "
+			<< "\"time_unit\": \"ns\", "
+			<< "\"ns_per_element\": " << nsPerElement(r) << ", "
+			<< "\"allocs\": " << r.allocs << ", "
+			<< "\"bytes\": " << r.bytes << ", "
+			<< "\"peak_bytes\": " << r.peakBytes << ", "
+			<< "\"samples\": [";
+		for (size_t k = 0; k < r.samples.size(); k++)
+			out << (k ? ", " : "") << r.samples[k];
+		out << "]";
+		if (r.counterMode != PerfOff) {
+			out << ", \"counters\": {";
+			bool first = true;
+			for (int c = 0; c < PERF_COUNTER_COUNT; c++) {
+				if (!hasCounter(r, (PERF_COUNTER)c)) continue;
+				out << (first ? "" : ", ") << "\"" << perfCounterName((PERF_COUNTER)c) << "\": " << r.counters[c];
+				first = false;
+			}
+			out << "}";
+		}
+		if (r.stage == stageName(StageReorder) && opt.parse.vertexOrder != OrderSorted)
+			out << ", \"bandwidth_before\": " << r.bandwidth[0] << ", \"bandwidth_after\": " << r.bandwidth[1];
+		if (r.stage == "total") {
+			out << ", \"subsystems\": {";
+			for (int k = 0; k < SUBSYSTEM_COUNT; k++) {
+				const MemCounters &m = r.subsystems[k];
+				out << (k ? ", " : "") << "\"" << subsystemName((SUBSYSTEM)k) << "\": {"
+					<< "\"allocs\": " << m.allocs << ", \"bytes\": " << m.bytes
+					<< ", \"peak_bytes\": " << m.peakBytes << "}";
+			}
+			out << "}";
+		}
+		out << "}";
+	}
+	out << "\n  ],\n  \"scaling\": [";
+	for (size_t i = 0; i < fits.size(); i++) {
+		out << (i ? "," : "") << "\n    {"
+			<< "\"group\": \"" << jsonEscape(fits[i].group) << "\", "
+			<< "\"stage\": \"" << fits[i].stage << "\", "
+			<< "\"exponent\": " << fits[i].exponent << "}";
+	}
+	out << "\n  ]";
+	if (opt.reuse && !batch.allocs.empty()) {
+		out << ",\n  \"batch\": {\"parses\": " << batch.allocs.size()
+			<< ", \"first_allocs\": " << batch.allocs[0]
+			<< ", \"later_allocs_mean\": " << meanFrom(batch.allocs, 1)
+			<< ", \"amortized_allocs\": " << meanFrom(batch.allocs, 0) << "}";
+	}
+	out << "\n}\n";
+}
+
+int main(int argc, char **argv) {
+	Options opt;
+	if (!parseArgs(argc, argv, opt)) {
+		usage();
+		return 2;
+	}
+	setPerfCountersEnabled(opt.counters);
+	setSimdLevel(opt.simd);
+
+	vector<Result> results;
+	Batch batch;
+	unique_ptr<Pattern> reused;
+	if (opt.reuse)
+		reused.reset(new Pattern(""));
+	for (const string &spec : opt.synthetic) {
+		TESSELLATION kind;
+		vector<int> sizes;
+		if (!parseSynthetic(spec, kind, sizes)) {
+			usage();
+			return 2;
+		}
+		string group = string("synthetic/") + tessellationName(kind);
+		for (int n : sizes) {
+			vector<Edge> creases = generateTessellation(kind, n);
+			string name = group + "/" + to_string(n);
+			benchCase(name, &creases, group, name, opt, reused.get(), batch, results);
+		}
+	}
+
+	// the corpus runs unless only synthetic inputs were asked for
+	if (opt.synthetic.empty() || !opt.assets.empty()) {
+		string root = findAssets(opt.assets);
+		if (!fs::is_directory(root)) {
+			cerr << "assets directory not found: " << root << '\n';
+			return 2;
+		}
+		for (const fs::path &path : collectFiles(root, opt.filter)) {
+			string name = fs::relative(path, root).generic_string();
+			benchCase(path.string(), NULL, "", name, opt, reused.get(), batch, results);
+		}
+	}
+	vector<Scaling> fits = fitScaling(results);
+
+	ofstream file;
+	if (!opt.out.empty()) {
+		file.open(opt.out);
+		if (!file) {
+			cerr << "cannot write " << opt.out << '\n';
+			return 2;
+		}
+	}
+	ostream &out = opt.out.empty() ? cout : file;
+
+	if (opt.format == "json") reportJSON(out, results, fits, batch, opt);
+	else if (opt.format == "csv") reportCSV(out, results);
+	else reportConsole(out, results, fits, batch, opt);
+	return 0;
+}
@@ -0,0 +1,332 @@
+/*
+ * Compares a pattern_bench JSON run against a stored baseline.
+ *
+ *   pattern_bench --repetitions 9 --format json --out baseline.json
+ *   ... change code ...
+ *   pattern_bench --repetitions 9 --format json --out current.json
+ *   pattern_compare baseline.json current.json
+ *
+ * A stage of a file counts as a regression only when all of these hold:
+ *  - a one-sided Mann-Whitney U test on the per-repetition samples says the
+ *    current run is slower with p < --alpha,
+ *  - the median grew by more than --threshold (relative),
+ *  - the median grew by more than --min-time nanoseconds, so that stages
+ *    that take a few microseconds cannot fail the run on noise alone.
+ * Heap allocation counts are deterministic and are compared directly
+ * against --alloc-threshold.
+ *
+ * Exits with 1 when anything regressed, 2 on bad input.
+ */
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+/* Minimal JSON reader, enough for pattern_bench output. */
+
+struct JSONValue {
+	enum KIND { Null, Bool, Number, String, Array, Object } kind;
+	double number;
+	string str;
+	vector<JSONValue> items;
+	map<string, JSONValue> fields;
+
+	JSONValue() :kind(Null), number(0) {}
+
+	const JSONValue *get(const string &key) const {
+		map<string, JSONValue>::const_iterator it = fields.find(key);
+		return it == fields.end() ? NULL : &it->second;
+	}
+	double getNumber(const string &key, double fallback = 0.0) const {
+		const JSONValue *v = get(key);
+		return v && v->kind == Number ? v->number : fallback;
+	}
+	string getString(const string &key) const {
+		const JSONValue *v = get(key);
+		return v && v->kind == String ? v->str : "";
+	}
+};
+
+class JSONReader {
+private:
+	const string &text;
+	size_t pos;
+
+	void skipSpace() {
+		while (pos < text.size() && isspace((unsigned char)text[pos])) pos++;
+	}
+	bool consume(char c) {
+		skipSpace();
+		if (pos < text.size() && text[pos] == c) {
+			pos++;
+			return true;
+		}
+		return false;
+	}
+	bool parseString(string &out) {
+		if (!consume('"')) return false;
+		while (pos < text.size() && text[pos] != '"') {
+			char c = text[pos++];
+			if (c == '\\' && pos < text.size()) {
+				c = text[pos++];
+				if (c == 'n') c = '\n';
+				else if (c == 't') c = '\t';
+			}
+			out += c;
+		}
+		return consume('"');
+	}
+
+public:
+	JSONReader(const string &t) :text(t), pos(0) {}
+
+	bool parse(JSONValue &v) {
+		skipSpace();
+		if (pos >= text.size()) return false;
+		char c = text[pos];
+		if (c == '{') {
+			pos++;
+			v.kind = JSONValue::Object;
+			if (consume('}')) return true;
+			do {
+				string key;
+				if (!parseString(key) || !consume(':') || !parse(v.fields[key])) return false;
+			} while (consume(','));
+			return consume('}');
+		}
+		if (c == '[') {
+			pos++;
+			v.kind = JSONValue::Array;
+			if (consume(']')) return true;
+			do {
+				v.items.push_back(JSONValue());
+				if (!parse(v.items.back())) return false;
+			} while (consume(','));
+			return consume(']');
+		}
+		if (c == '"') {
+			v.kind = JSONValue::String;
+			return parseString(v.str);
+		}
+		if (text.compare(pos, 4, "true") == 0 || text.compare(pos, 5, "false") == 0) {
+			v.kind = JSONValue::Bool;
+			v.number = text[pos] == 't';
+			pos += text[pos] == 't' ? 4 : 5;
+			return true;
+		}
+		if (text.compare(pos, 4, "null") == 0) {
+			pos += 4;
+			return true;
+		}
+		char *end;
+		v.kind = JSONValue::Number;
+		v.number = strtod(text.c_str() + pos, &end);
+		if (end == text.c_str() + pos) return false;
+		pos = end - text.c_str();
+		return true;
+	}
+};
+
+/* Statistics */
+
+struct Entry {
+	string name;
+	double median;
+	double p95;
+	double allocs;
+	vector<double> samples;
+};
+
+static bool loadRun(const string &filename, map<string, Entry> &entries) {
+	ifstream in(filename);
+	if (!in) {
+		cerr << "cannot read " << filename << '\n';
+		return false;
+	}
+	stringstream ss;
+	ss << in.rdbuf();
+	string text = ss.str();
+
+	JSONValue root;
+	JSONReader reader(text);
+	const JSONValue *list = reader.parse(root) ? root.get("benchmarks") : NULL;
+	if (!list || list->kind != JSONValue::Array) {
+		cerr << filename << ": not a pattern_bench JSON file\n";
+		return false;
+	}
+	for (const JSONValue &b : list->items) {
+		Entry e;
+		e.name = b.getString("name");
+		e.median = b.getNumber("real_time");
+		e.p95 = b.getNumber("p95_time", e.median);
+		e.allocs = b.getNumber("allocs");
+		const JSONValue *samples = b.get("samples");
+		if (samples) {
+			for (const JSONValue &s : samples->items)
+				e.samples.push_back(s.number);
+		}
+		if (e.samples.empty())
+			e.samples.push_back(e.median);
+		entries[e.name] = e;
+	}
+	return true;
+}
+
+/*
+ * One-sided Mann-Whitney U test, H1: values in b tend to be larger than in a.
+ * Exact for small tie-free samples, normal approximation with tie and
+ * continuity correction otherwise.
+ */
+static double mannWhitneyGreater(const vector<double> &a, const vector<double> &b) {
+	size_t n1 = a.size(), n2 = b.size();
+	if (n1 == 0 || n2 == 0) return 1.0;
+
+	vector<pair<double, int>> all;
+	for (double x : a) all.push_back(make_pair(x, 0));
+	for (double x : b) all.push_back(make_pair(x, 1));
+	sort(all.begin(), all.end());
+
+	size_t n = all.size();
+	double rankSumB = 0, tieTerm = 0;
+	bool ties = false;
+	for (size_t i = 0; i < n;) {
+		size_t j = i;
+		while (j < n && all[j].first == all[i].first) j++;
+		double rank = 0.5 * (i + 1 + j);	// average of ranks i+1..j
+		for (size_t k = i; k < j; k++)
+			if (all[k].second == 1) rankSumB += rank;
+		double t = (double)(j - i);
+		if (t > 1) ties = true;
+		tieTerm += t * t * t - t;
+		i = j;
+	}
+	double u = rankSumB - n2 * (n2 + 1) / 2.0;	// pairs (x in a, y in b) with y > x
+
+	if (!ties && n1 <= 20 && n2 <= 20) {
+		// counts[k] = number of arrangements with U == k, built up one element at a time
+		size_t maxU = n1 * n2;
+		vector<vector<double>> prev(n1 + 1, vector<double>(maxU + 1, 0.0));
+		for (size_t i = 0; i <= n1; i++) prev[i][0] = 1.0;
+		for (size_t j = 1; j <= n2; j++) {
+			vector<vector<double>> cur(n1 + 1, vector<double>(maxU + 1, 0.0));
+			cur[0][0] = 1.0;
+			for (size_t i = 1; i <= n1; i++) {
+				for (size_t k = 0; k <= maxU; k++) {
+					// the largest element either comes from b (adds i to U) or from a
+					double v = cur[i - 1][k];
+					if (k >= i) v += prev[i][k - i];
+					cur[i][k] = v;
+				}
+			}
+			prev.swap(cur);
+		}
+		double total = 0, tail = 0;
+		for (size_t k = 0; k <= maxU; k++) {
+			total += prev[n1][k];
+			if ((double)k >= u) tail += prev[n1][k];
+		}
+		return tail / total;
+	}
+
+	double mean = n1 * n2 / 2.0;
+	double var = n1 * n2 / 12.0 * ((n + 1) - tieTerm / (n * (n - 1.0)));
+	if (var <= 0) return 1.0;
+	double z = (u - mean - 0.5) / sqrt(var);
+	return 0.5 * erfc(z / sqrt(2.0));
+}
+
+struct Options {
+	double alpha;
+	double threshold;
+	double minTime;
+	double allocThreshold;
+	Options() :alpha(0.05), threshold(0.05), minTime(20000.0), allocThreshold(0.10) {}
+};
+
+static void usage() {
+	cout << "usage: pattern_compare BASELINE.json CURRENT.json [--alpha P] [--threshold R]\n"
+		<< "                       [--min-time NS] [--alloc-threshold R]\n";
+}
+
+int main(int argc, char **argv) {
+	Options opt;
+	vector<string> files;
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--alpha" && hasValue) opt.alpha = atof(argv[++i]);
+		else if (arg == "--threshold" && hasValue) opt.threshold = atof(argv[++i]);
+		else if (arg == "--min-time" && hasValue) opt.minTime = atof(argv[++i]);
+		else if (arg == "--alloc-threshold" && hasValue) opt.allocThreshold = atof(argv[++i]);
+		else if (arg.compare(0, 2, "--") == 0) {
+			usage();
+			return 2;
+		}
+		else files.push_back(arg);
+	}
+	if (files.size() != 2) {
+		usage();
+		return 2;
+	}
+
+	map<string, Entry> baseline, current;
+	if (!loadRun(files[0], baseline) || !loadRun(files[1], current))
+		return 2;
+
+	int regressions = 0, improvements = 0, missing = 0;
+	char line[512];
+	for (map<string, Entry>::const_iterator it = current.begin(); it != current.end(); ++it) {
+		map<string, Entry>::const_iterator base = baseline.find(it->first);
+		if (base == baseline.end()) {
+			missing++;
+			continue;
+		}
+		const Entry &b = base->second, &c = it->second;
+		double delta = c.median - b.median;
+		double ratio = b.median > 0 ? delta / b.median : 0.0;
+
+		const char *verdict = NULL;
+		double p = 1.0;
+		if (delta > opt.minTime && ratio > opt.threshold) {
+			p = mannWhitneyGreater(b.samples, c.samples);
+			if (p < opt.alpha) verdict = "SLOWER";
+		}
+		else if (-delta > opt.minTime && -ratio > opt.threshold) {
+			p = mannWhitneyGreater(c.samples, b.samples);
+			if (p < opt.alpha) verdict = "faster";
+		}
+		bool moreAllocs = c.allocs > b.allocs * (1.0 + opt.allocThreshold) && c.allocs - b.allocs >= 1.0;
+
+		if (verdict && verdict[0] == 'S') regressions++;
+		if (verdict && verdict[0] == 'f') improvements++;
+		if (moreAllocs) regressions++;
+		if (!verdict && !moreAllocs) continue;
+
+		snprintf(line, sizeof(line), "%-8s %-60s %10.3f -> %10.3f ms (%+6.1f%%, p=%.4f, p95 %.3f -> %.3f ms)",
+			verdict ? verdict : "", it->first.c_str(), b.median / 1e6, c.median / 1e6,
+			100.0 * ratio, p, b.p95 / 1e6, c.p95 / 1e6);
+		cout << line << '\n';
+		if (moreAllocs) {
+			snprintf(line, sizeof(line), "%-8s %-60s %10.0f -> %10.0f allocations",
+				"ALLOCS", it->first.c_str(), b.allocs, c.allocs);
+			cout << line << '\n';
+		}
+	}
+	for (map<string, Entry>::const_iterator it = baseline.begin(); it != baseline.end(); ++it) {
+		if (current.find(it->first) == current.end()) missing++;
+	}
+
+	cout << current.size() << " benchmarks compared, " << regressions << " regressions, "
+		<< improvements << " improvements";
+	if (missing) cout << ", " << missing << " present in only one run";
+	cout << '\n';
+	return regressions ? 1 : 0;
+}
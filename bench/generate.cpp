@@ -0,0 +1,53 @@
+/*
+ * Writes a synthetic crease pattern as SVG.
+ *
+ *   pattern_gen miura|twist|resch|random N [--cell SIZE] [--seed S] [--out FILE]
+ */
+#include <cstdlib>
+#include <fstream>
+
+#include "generator.h"
+
+static void usage() {
+	cout << "usage: pattern_gen miura|twist|resch|random N [--cell SIZE] [--seed S] [--out FILE]\n";
+}
+
+int main(int argc, char **argv) {
+	TESSELLATION kind;
+	if (argc < 3 || !tessellationFromName(argv[1], kind)) {
+		usage();
+		return 2;
+	}
+	int n = atoi(argv[2]);
+	float cell = 100.0f;
+	unsigned seed = 1;
+	string outName;
+	for (int i = 3; i < argc; i++) {
+		string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--cell" && hasValue) cell = (float)atof(argv[++i]);
+		else if (arg == "--seed" && hasValue) seed = (unsigned)strtoul(argv[++i], NULL, 10);
+		else if (arg == "--out" && hasValue) outName = argv[++i];
+		else {
+			usage();
+			return 2;
+		}
+	}
+	if (n < 1 || cell <= 0) {
+		usage();
+		return 2;
+	}
+
+	vector<Edge> creases = generateTessellation(kind, n, cell, seed);
+	if (outName.empty()) {
+		writeSVG(cout, creases);
+		return 0;
+	}
+	ofstream out(outName);
+	if (!out) {
+		cerr << "cannot write " << outName << '\n';
+		return 2;
+	}
+	writeSVG(out, creases);
+	return 0;
+}
@@ -0,0 +1,65 @@
+/*
+ * Parallel face extraction must give exactly the faces of the serial walk,
+ * with the same ids, for any number of threads.
+ *
+ *   faces_test [ASSETS_DIR]
+ */
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+
+#include "pattern.h"
+#include "generator.h"
+
+namespace fs = std::filesystem;
+
+static bool sameFaces(const Pattern &a, const Pattern &b) {
+	const FaceArray &fa = a.faceCycles(), &fb = b.faceCycles();
+	return fa.offsets == fb.offsets && fa.vts == fb.vts && fa.area == fb.area &&
+		fa.orientation == fb.orientation && fa.kind == fb.kind && fa.parent == fb.parent;
+}
+
+// Parses one input with serial and parallel faces; returns the number of mismatches.
+static int check(const string &name, const vector<Edge> *creases) {
+	Pattern serial = creases ? Pattern(*creases, name) : Pattern(name);
+	serial.parse();
+	int failures = 0;
+	const int threads[] = { 1, 2, 4 };
+	for (int t : threads) {
+		Pattern parallel = creases ? Pattern(*creases, name) : Pattern(name);
+		parallel.options.faces = FacesParallel;
+		parallel.options.threads = t;
+		parallel.parse();
+		if (!sameFaces(serial, parallel)) {
+			printf("FAIL %s: faces on %d threads differ from serial (%d vs %d faces)\n", name.c_str(), t,
+				(int)parallel.faceCycles().size(), (int)serial.faceCycles().size());
+			failures++;
+		}
+	}
+	return failures;
+}
+
+int main(int argc, char **argv) {
+	int failures = 0, inputs = 0;
+	for (int k = 0; k < TESSELLATION_COUNT; k++) {
+		for (int n : { 4, 12 }) {
+			vector<Edge> creases = generateTessellation((TESSELLATION)k, n);
+			failures += check(string(tessellationName((TESSELLATION)k)) + ":" + to_string(n), &creases);
+			inputs++;
+		}
+	}
+	if (argc > 1 && fs::is_directory(argv[1])) {
+		vector<string> files;
+		for (const fs::directory_entry &entry : fs::recursive_directory_iterator(argv[1])) {
+			if (entry.is_regular_file() && entry.path().extension() == ".svg")
+				files.push_back(entry.path().string());
+		}
+		sort(files.begin(), files.end());
+		for (const string &f : files) {
+			failures += check(f, NULL);
+			inputs++;
+		}
+	}
+	printf("%d inputs, %d mismatches\n", inputs, failures);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,100 @@
+/*
+ * Every SIMD level must give intersectBlock() results identical to the
+ * scalar one, lane by lane: the same hit mask and bit-identical t1 and t2,
+ * including for nearly parallel pairs whose bounding boxes are apart.
+ *
+ *   simd_test
+ */
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+#include "intersect.h"
+
+const float TOL = 1e-3f;
+
+// Runs segs[0] against every block of segs[1..] at every count up to SEG_BLOCK.
+static int check(const char *name, const SegmentArray &segs) {
+	int failures = 0;
+	int n = (int)segs.size();
+	for (int first = 1; first < n; first += SEG_BLOCK) {
+		int most = n - first < SEG_BLOCK ? n - first : SEG_BLOCK;
+		for (int count = 1; count <= most; count++) {
+			float t1[SEG_BLOCK], t2[SEG_BLOCK];
+			setSimdLevel(SimdScalar);
+			unsigned expect = intersectBlock(segs, 0, first, count, TOL, t1, t2);
+			for (int l = SimdScalar + 1; l <= simdSupported(); l++) {
+				float u1[SEG_BLOCK], u2[SEG_BLOCK];
+				setSimdLevel((SIMD_LEVEL)l);
+				unsigned mask = intersectBlock(segs, 0, first, count, TOL, u1, u2);
+				for (int k = 0; k < count; k++) {
+					bool same = ((mask ^ expect) >> k & 1) == 0 &&
+						memcmp(&u1[k], &t1[k], sizeof(float)) == 0 && memcmp(&u2[k], &t2[k], sizeof(float)) == 0;
+					if (!same) {
+						printf("FAIL %s: %s lane %d of block %d/%d: hit %u t (%g, %g), scalar hit %u t (%g, %g)\n",
+							name, simdLevelName((SIMD_LEVEL)l), k, first, count,
+							mask >> k & 1, u1[k], u2[k], expect >> k & 1, t1[k], t2[k]);
+						failures++;
+					}
+				}
+			}
+		}
+	}
+	setSimdLevel(simdSupported());
+	return failures;
+}
+
+// Candidates nearly parallel to the query, each with a bounding box apart from it.
+static SegmentArray nearParallelApart() {
+	SegmentArray segs;
+	segs.add(0, 0, 10, 0.001f);
+	for (int k = 0; k < 2 * SEG_BLOCK; k++) {
+		float e = (k % 4) * 1e-4f;
+		switch (k % 4) {
+		case 0: segs.add(12 + k, 0, 20 + k, 0.0008f + e); break;	// further along, beyond maxX
+		case 1: segs.add(-9 - k, -0.001f, -1 - k, e); break;		// before minX
+		case 2: segs.add(0, 5 + k, 10, 5 + k + 0.001f + e); break;	// above maxY
+		default: segs.add(10, -3 - k, 0, -3 - k - e); break;		// below minY, reversed
+		}
+	}
+	return segs;
+}
+
+// Random segments, with a share of near-parallel and overlapping ones.
+static SegmentArray randomSegments(unsigned seed) {
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<float> pos(-10, 10), tiny(-1e-4f, 1e-4f);
+	SegmentArray segs;
+	float ax = pos(rng), ay = pos(rng), bx = pos(rng), by = pos(rng);
+	segs.add(ax, ay, bx, by);
+	for (int k = 0; k < 5 * SEG_BLOCK + 3; k++) {
+		switch (rng() % 3) {
+		case 0: segs.add(pos(rng), pos(rng), pos(rng), pos(rng)); break;
+		case 1: {	// parallel, shifted along and possibly off the line
+			float s = pos(rng) / 10, off = rng() % 2 ? tiny(rng) : pos(rng);
+			float dx = bx - ax, dy = by - ay;
+			segs.add(ax + s * dx - off * dy, ay + s * dy + off * dx, bx + s * dx + tiny(rng), by + s * dy + tiny(rng));
+			break;
+		}
+		default:	// on the query's line, in a random range
+			float s0 = pos(rng) / 5, s1 = pos(rng) / 5;
+			segs.add(ax + s0 * (bx - ax), ay + s0 * (by - ay), ax + s1 * (bx - ax), ay + s1 * (by - ay));
+			break;
+		}
+	}
+	return segs;
+}
+
+int main() {
+	int failures = 0, inputs = 0;
+	failures += check("near-parallel, boxes apart", nearParallelApart());
+	inputs++;
+	for (unsigned seed = 1; seed <= 200; seed++) {
+		char name[32];
+		snprintf(name, sizeof name, "random %u", seed);
+		failures += check(name, randomSegments(seed));
+		inputs++;
+	}
+	printf("%d inputs up to %s, %d mismatches\n", inputs, simdLevelName(simdSupported()), failures);
+	return failures ? 1 : 0;
+}
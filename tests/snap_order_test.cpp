@@ -0,0 +1,93 @@
+/*
+ * In snap-rounding mode the result must not depend on how the vertices are
+ * numbered: every VERTEX_ORDER gives the same faces, compared by their
+ * coordinates, and the same number of triangles. Which diagonal splits a
+ * square is left to the numbering, so the triangles themselves may differ.
+ *
+ *   snap_order_test [ASSETS_DIR]
+ */
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <filesystem>
+
+#include "pattern.h"
+#include "generator.h"
+
+namespace fs = std::filesystem;
+
+const double SNAP_STEP = 1.0 / 1024;
+
+typedef array<float, 2> Point;
+
+// Face cycles as (kind, corner points), each in its smallest rotation, sorted.
+static vector<pair<int, vector<Point>>> faceSet(const Pattern &p) {
+	const VertexArray &vts = p.vertexArray();
+	const FaceArray &faces = p.faceCycles();
+	vector<pair<int, vector<Point>>> out;
+	for (size_t f = 0; f < faces.size(); f++) {
+		vector<Point> cycle;
+		for (const int *v = faces.begin(f); v != faces.end(f); v++)
+			cycle.push_back({ vts.x[*v], vts.y[*v] });
+		// the smallest rotation; a spur visits its base point twice
+		vector<Point> best = cycle;
+		for (size_t k = 1; k < cycle.size(); k++) {
+			rotate(cycle.begin(), cycle.begin() + 1, cycle.end());
+			best = min(best, cycle);
+		}
+		out.push_back(make_pair((int)faces.kind[f], best));
+	}
+	sort(out.begin(), out.end());
+	return out;
+}
+
+// Parses one input snapped in every vertex order; returns the number of mismatches.
+static int check(const string &name, const vector<Edge> *creases) {
+	static const char *orderNames[] = { "sorted", "morton", "rcm" };
+	const VERTEX_ORDER orders[] = { OrderSorted, OrderMorton, OrderRCM };
+	vector<pair<int, vector<Point>>> faces;
+	size_t triangles = 0;
+	int failures = 0;
+	for (VERTEX_ORDER order : orders) {
+		Pattern p = creases ? Pattern(*creases, name) : Pattern(name);
+		p.options.snapGrid = SNAP_STEP;
+		p.options.vertexOrder = order;
+		p.parse();
+		if (order == OrderSorted) {
+			faces = faceSet(p);
+			triangles = p.faceTriangles().size();
+			continue;
+		}
+		if (faceSet(p) != faces || p.faceTriangles().size() != triangles) {
+			printf("FAIL %s: %s order gives %d triangles, sorted order %d\n",
+				name.c_str(), orderNames[order], (int)p.faceTriangles().size(), (int)triangles);
+			failures++;
+		}
+	}
+	return failures;
+}
+
+int main(int argc, char **argv) {
+	int failures = 0, inputs = 0;
+	for (int k = 0; k < TESSELLATION_COUNT; k++) {
+		for (int n : { 4, 12 }) {
+			vector<Edge> creases = generateTessellation((TESSELLATION)k, n);
+			failures += check(string(tessellationName((TESSELLATION)k)) + ":" + to_string(n), &creases);
+			inputs++;
+		}
+	}
+	if (argc > 1 && fs::is_directory(argv[1])) {
+		vector<string> files;
+		for (const fs::directory_entry &entry : fs::recursive_directory_iterator(argv[1])) {
+			if (entry.is_regular_file() && entry.path().extension() == ".svg")
+				files.push_back(entry.path().string());
+		}
+		sort(files.begin(), files.end());
+		for (const string &f : files) {
+			failures += check(f, NULL);
+			inputs++;
+		}
+	}
+	printf("%d inputs, %d mismatches\n", inputs, failures);
+	return failures ? 1 : 0;
+}
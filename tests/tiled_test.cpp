@@ -0,0 +1,65 @@
+/*
+ * The tiled intersection search must give exactly the planar graph of the
+ * serial one, for any number of threads.
+ *
+ *   tiled_test [ASSETS_DIR]
+ */
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+
+#include "pattern.h"
+#include "generator.h"
+
+namespace fs = std::filesystem;
+
+static bool sameGraph(const Pattern &a, const Pattern &b) {
+	const VertexArray &va = a.vertexArray(), &vb = b.vertexArray();
+	const EdgeArray &ea = a.edgeArray(), &eb = b.edgeArray();
+	return va.x == vb.x && va.y == vb.y &&
+		ea.v0 == eb.v0 && ea.v1 == eb.v1 && ea.angle == eb.angle && ea.type == eb.type;
+}
+
+// Parses one input serially and tiled; returns the number of mismatches.
+static int check(const string &name, const vector<Edge> *creases) {
+	Pattern serial = creases ? Pattern(*creases, name) : Pattern(name);
+	serial.parse();
+	int failures = 0;
+	const int threads[] = { 1, 2, 4 };
+	for (int t : threads) {
+		Pattern tiled = creases ? Pattern(*creases, name) : Pattern(name);
+		tiled.options.intersect = IntersectTiled;
+		tiled.options.threads = t;
+		tiled.parse();
+		if (!sameGraph(serial, tiled)) {
+			printf("FAIL %s: tiled on %d threads differs from serial\n", name.c_str(), t);
+			failures++;
+		}
+	}
+	return failures;
+}
+
+int main(int argc, char **argv) {
+	int failures = 0, inputs = 0;
+	for (int k = 0; k < TESSELLATION_COUNT; k++) {
+		for (int n : { 4, 12 }) {
+			vector<Edge> creases = generateTessellation((TESSELLATION)k, n);
+			failures += check(string(tessellationName((TESSELLATION)k)) + ":" + to_string(n), &creases);
+			inputs++;
+		}
+	}
+	if (argc > 1 && fs::is_directory(argv[1])) {
+		vector<string> files;
+		for (const fs::directory_entry &entry : fs::recursive_directory_iterator(argv[1])) {
+			if (entry.is_regular_file() && entry.path().extension() == ".svg")
+				files.push_back(entry.path().string());
+		}
+		sort(files.begin(), files.end());
+		for (const string &f : files) {
+			failures += check(f, NULL);
+			inputs++;
+		}
+	}
+	printf("%d inputs, %d mismatches\n", inputs, failures);
+	return failures ? 1 : 0;
+}